@@ -0,0 +1,206 @@
+/******************************************************************************\
+*  文件： bench.c
+*  介绍： 低时延队列 单入单出/多入单出 吞吐量测试
+*  作者： 荣涛
+*  日期：
+*       2026年10月17日
+*
+*  ./bench.epoll.out [消息总数] [发送CPU] [接收CPU]
+\******************************************************************************/
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <fastq.h>
+
+#define BENCH_RX    1
+#define BENCH_TX    2
+#define BENCH_TX_MP 3   //多入单出队列
+
+#define BENCH_RING_SIZE 1024
+
+enum {
+	BENCH_SEND,
+	BENCH_SEND_BATCH,
+	BENCH_RESERVE,
+};
+
+static const struct bench_case {
+	const char *name;
+	int api;
+	unsigned long from;
+	int nr_threads;
+} bench_cases[] = {
+	{"FastQSend",           BENCH_SEND,         BENCH_TX,       1},
+	{"FastQSendBatch",      BENCH_SEND_BATCH,   BENCH_TX,       1},
+	{"FastQReserve",        BENCH_RESERVE,      BENCH_TX,       1},
+	{"MPSC FastQSend",      BENCH_SEND,         BENCH_TX_MP,    1},
+	{"MPSC FastQSendBatch", BENCH_SEND_BATCH,   BENCH_TX_MP,    1},
+	{"MPSC FastQReserve",   BENCH_RESERVE,      BENCH_TX_MP,    1},
+	{"MPSC FastQSend x2",   BENCH_SEND,         BENCH_TX_MP,    2},
+	{"MPSC FastQSend x4",   BENCH_SEND,         BENCH_TX_MP,    4},
+};
+
+#define BENCH_NR_CASES  (sizeof(bench_cases)/sizeof(bench_cases[0]))
+
+static unsigned long nr_msgs = 10000000UL;
+static char *tx_cpu = "1";
+static char *rx_cpu = "0";
+
+static volatile unsigned long recv_msgs = 0;
+static volatile unsigned long recv_sum = 0;
+
+static uint64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static void bench_handler(unsigned long src, unsigned long dst,
+		unsigned long type, unsigned long code, unsigned long subcode,
+		const void* msg, size_t size)
+{
+	recv_sum += *(const unsigned long*)msg;
+	recv_msgs++;
+}
+
+static void *bench_recv_task(void *arg)
+{
+	reset_self_cpuset(rx_cpu);
+	FastQRecvZeroCopy(BENCH_RX, bench_handler);
+	pthread_exit(NULL);
+}
+
+static void bench_send(int api, unsigned long from,
+		unsigned long begin, unsigned long end)
+{
+	struct FastQBatchMsg batch[FASTQ_BURST_MAX];
+	unsigned long values[FASTQ_BURST_MAX];
+	unsigned long i, j, n;
+
+	switch (api) {
+	case BENCH_SEND:
+		for (i = begin; i < end; i++) {
+			FastQSend(from, BENCH_RX, 0, 0, 0, &i, sizeof(i));
+		}
+		break;
+	case BENCH_SEND_BATCH:
+		for (i = begin; i < end; i += n) {
+			n = end - i;
+			n = n < FASTQ_BURST_MAX ? n : FASTQ_BURST_MAX;
+			for (j = 0; j < n; j++) {
+				values[j] = i + j;
+				batch[j].msgType = batch[j].msgCode = batch[j].msgSubCode = 0;
+				batch[j].msg = &values[j];
+				batch[j].size = sizeof(unsigned long);
+			}
+			FastQSendBatch(from, BENCH_RX, batch, n);
+		}
+		break;
+	case BENCH_RESERVE:
+		for (i = begin; i < end; i++) {
+			unsigned long *p = FastQReserve(from, BENCH_RX, sizeof(i));
+			*p = i;
+			FastQCommit(from, BENCH_RX, 0, 0, 0, sizeof(i));
+		}
+		break;
+	}
+}
+
+struct bench_sender {
+	const struct bench_case *bc;
+	unsigned long begin, end;
+};
+
+static void *bench_send_task(void *arg)
+{
+	struct bench_sender *sender = arg;
+
+	reset_self_cpuset(tx_cpu);
+	bench_send(sender->bc->api, sender->bc->from, sender->begin, sender->end);
+	pthread_exit(NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t recv_task;
+	unsigned long base = 0, expect_sum = 0, i;
+	uint64_t start, end;
+	int c, t;
+
+	if (argc > 1) nr_msgs = strtoul(argv[1], NULL, 0);
+	if (argc > 2) tx_cpu = argv[2];
+	if (argc > 3) rx_cpu = argv[3];
+
+	/* 发送和接收在同一个 CPU 上时测到的是上下文切换，不是跨核缓存行开销 */
+	cpu_set_t tx_set, rx_set, both;
+	char *tx_list = strdup(tx_cpu), *rx_list = strdup(rx_cpu);
+	CPU_ZERO(&tx_set);
+	CPU_ZERO(&rx_set);
+	__parse_cpu_list(tx_list, &tx_set);
+	__parse_cpu_list(rx_list, &rx_set);
+	CPU_AND(&both, &tx_set, &rx_set);
+	if (CPU_COUNT(&both)) {
+		printf("[WARNING] sender (%s) and receiver (%s) share a CPU (%ld online), "
+			"numbers below are not cross-core\n",
+			tx_cpu, rx_cpu, sysconf(_SC_NPROCESSORS_ONLN));
+	}
+	free(tx_list);
+	free(rx_list);
+
+	struct FastQModuleAttr mp_attr = FASTQ_MODULE_ATTR_INITIALIZER;
+	mp_attr.flags = FASTQ_MODULE_F_MPSC;
+
+	FastQCreateModule(BENCH_RX, NULL, NULL, BENCH_RING_SIZE, sizeof(unsigned long));
+	FastQCreateModule(BENCH_TX, NULL, NULL, BENCH_RING_SIZE, sizeof(unsigned long));
+	FastQCreateModuleAttr(BENCH_TX_MP, NULL, NULL, BENCH_RING_SIZE, sizeof(unsigned long),
+			&mp_attr);
+
+	pthread_create(&recv_task, NULL, bench_recv_task, NULL);
+	reset_self_cpuset(tx_cpu);
+
+	printf("\t%-20s %12s %12s %12s\n", "API", "msgs", "ns/msg", "Mmsg/s");
+
+	for (c = 0; c < BENCH_NR_CASES; c++) {
+		const struct bench_case *bc = &bench_cases[c];
+		struct bench_sender senders[bc->nr_threads];
+		pthread_t send_tasks[bc->nr_threads];
+
+		for (i = base; i < base + nr_msgs; i++) {
+			expect_sum += i;
+		}
+
+		start = now_ns();
+		if (bc->nr_threads == 1) {
+			bench_send(bc->api, bc->from, base, base + nr_msgs);
+		} else {
+			for (t = 0; t < bc->nr_threads; t++) {
+				senders[t].bc = bc;
+				senders[t].begin = base + nr_msgs * t / bc->nr_threads;
+				senders[t].end = base + nr_msgs * (t + 1) / bc->nr_threads;
+				pthread_create(&send_tasks[t], NULL, bench_send_task, &senders[t]);
+			}
+			for (t = 0; t < bc->nr_threads; t++) {
+				pthread_join(send_tasks[t], NULL);
+			}
+		}
+		while (recv_msgs < base + nr_msgs) {
+			sched_yield();
+		}
+		end = now_ns();
+
+		assert(recv_sum == expect_sum && "bench message lost.");
+
+		printf("\t%-20s %12lu %12.2lf %12.2lf\n", bc->name, nr_msgs,
+			(end - start) * 1.0 / nr_msgs, nr_msgs * 1000.0 / (end - start));
+		base += nr_msgs;
+	}
+
+	FastQDump(stdout, BENCH_RX);
+
+	return EXIT_SUCCESS;
+}
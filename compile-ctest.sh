@@ -25,12 +25,29 @@ LIBS="$redis_dict_objs fastq.c -lcrypt -pthread -I./ -I$redis_dict_dir -g"
 #file=$1
 # (test-0.c test-1.c test-2.c test-3.c test-4.c test-5.c)
 #
-test_files=(test.c )
+test_files=(test.c bench.c )
 for file in ${test_files[@]}
 do
 	echo "Compile $file -> ${file%.*}.out"
 	gcc $file $LIBS -o ${file%.*}.epoll.out -w $* -D_FASTQ_EPOLL=1 -g -ggdb
 	gcc $file $LIBS -o ${file%.*}.select.out -w $* -D_FASTQ_SELECT=1 -g -ggdb
+	gcc $file $LIBS -o ${file%.*}.poll.out -w $* -D_FASTQ_POLL=1 -g -ggdb
+	gcc $file $LIBS -o ${file%.*}.futex.out -w $* -D_FASTQ_FUTEX=1 -g -ggdb
+	gcc $file $LIBS -o ${file%.*}.io_uring.out -w $* -D_FASTQ_IO_URING=1 -g -ggdb
 done
 
-
+# 接口行为测试：每个后端编译一份，另外一份打开统计功能，一份使用 32 位消息头字段，逐个运行，失败时退出
+echo "Compile test-api.c -> test-api.*.out"
+gcc test-api.c $LIBS -o test-api.epoll.out -w $* -D_FASTQ_EPOLL=1 -g -ggdb
+gcc test-api.c $LIBS -o test-api.select.out -w $* -D_FASTQ_SELECT=1 -g -ggdb
+gcc test-api.c $LIBS -o test-api.poll.out -w $* -D_FASTQ_POLL=1 -g -ggdb
+gcc test-api.c $LIBS -o test-api.futex.out -w $* -D_FASTQ_FUTEX=1 -g -ggdb
+gcc test-api.c $LIBS -o test-api.io_uring.out -w $* -D_FASTQ_IO_URING=1 -g -ggdb
+gcc test-api.c $LIBS -o test-api.stats.out -w $* -D_FASTQ_STATS=1 -g -ggdb
+gcc test-api.c $LIBS -o test-api.hdr32.out -w $* -DFASTQ_HDR_FIELD_BITS=32 -g -ggdb
+
+for test in test-api.*.out
+do
+	echo "Run $test"
+	./$test || exit 1
+done
@@ -25,8 +25,37 @@
 *       2021年4月25日 添加 msgCode,msgType,moduleID
 *       2021年4月28日 添加 msgSubCode
 *       2021年5月11日 FastQ环回 环形队列（用户向自己发送消息）
+*       2026年10月17日 批量发送接口，一次 eventfd_write 发送多条消息 (FastQSendBatch)
+*       2026年10月17日 批量接收接口 FastQRecvBurst，一次回调处理一批消息
+*       2026年10月17日 零拷贝发送接口 FastQReserve/FastQCommit
+*       2026年10月17日 零拷贝接收接口 FastQPeek/FastQRelease, FastQRecvZeroCopy
+*       2026年10月17日 环形队列按缓存行划分生产者/消费者字段，缓存对端下标
+*       2026年10月17日 统计功能可编译去除 (_FASTQ_STATS)，开启时使用单写者计数器
+*       2026年10月17日 变长消息队列 (FASTQ_MODULE_F_VARLEN)
+*       2026年10月17日 紧凑消息头 (FASTQ_HDR_FIELD_BITS)，节点步长按 16/32/64 字节对齐
+*       2026年10月17日 多生产者队列 (FASTQ_MODULE_F_MPSC)
+*       2026年10月17日 多消费者接收 (FASTQ_MODULE_F_MULTI_CONSUMER)
+*       2026年10月17日 广播队列 FastQBroadcast：一次写入，多个接收模块各自读取
+*       2026年10月17日 高优先级通道 FastQSendPrio/FastQTrySendPrio
+*       2026年10月17日 在线调整队列大小 FastQResizeRing，自动扩容 (FASTQ_MODULE_F_AUTO_GROW)
+*       2026年10月17日 按源模块配置队列大小和消息大小 FastQConfigureEdge
+*       2026年10月17日 队列满策略 FastQSetFullPolicy：阻塞、丢弃最新、覆盖最旧、按优先级丢弃
+*       2026年10月17日 队列满时自适应退避，超时发送接口 FastQSendTimed
+*       2026年10月17日 非阻塞接收 FastQRecvOnce，导出就绪 fd FastQGetFd
+*       2026年10月17日 忙轮询接收 (FASTQ_MODULE_F_BUSY_POLL)，接收方轮询时生产者不通知
+*       2026年10月17日 门铃通知：队列由空变为非空时才写 eventfd，接收方读空队列后重新使能
+*       2026年10月17日 futex 后端 (_FASTQ_FUTEX)：每个接收模块一个 futex，不使用 eventfd
+*       2026年10月17日 io_uring 后端 (_FASTQ_IO_URING)：多次触发的 poll，批量收割就绪的 eventfd
+*       2026年10月17日 纯忙轮询模块 (FASTQ_MODULE_F_POLL_ONLY)，数据路径不使用 fd
+*       2026年10月17日 通知后端改为每个模块注册时选择 (FastQModuleAttr.backend)，新增 poll 后端，
+*                     fd->ring 快表按需分配，不再受 FD_SETSIZE 限制
+*       2026年10月17日 每个接收模块一个门铃 + 按源模块ID索引的就绪位图，不再为每个队列创建 eventfd
+*       2026年10月17日 每个模块维护紧凑的活跃队列列表 (RCU)，统计、删除、忙轮询不再遍历 FASTQ_ID_MAX
+*       2026年10月17日 广播队列满时退避等待最慢的读者，超时广播接口 FastQBroadcastTimed
+*       2026年10月17日 超时接口 FastQSendPrioTimed/FastQSendBatchTimed/FastQReserveTimed
 \*****************************************************************************/
 #include <stdint.h>
+#include <limits.h>
 #include <assert.h>
 
 #include <sys/mman.h>
@@ -42,6 +71,12 @@
 #include <sys/eventfd.h> //eventfd
 #include <sys/select.h> //FD_SETSIZE
 #include <sys/epoll.h>
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
 #include <pthread.h>
 
 #include <fastq.h>
@@ -49,37 +84,161 @@
 #include <dict.h>   //哈希查找 模块名 -> moduleID
 #include <sds.h>
 
-/* 多路复用器 的选择， 默认采用 select()
+/* 多路复用器 的选择，每个模块注册时由 FastQModuleAttr.backend 指定，
+ * 编译宏只决定 FASTQ_BACKEND_DEFAULT 对应的后端， 默认采用 select()
  *  epoll 实时内核对 epoll 影响非常严重，详情请见
  *    Sys_epoll_wait->spin_lock_local
- *  select 实时内核对 select 影响不严重 */
-#if defined(_FASTQ_EPOLL) && defined(_FASTQ_SELECT)
-# error "You must choose one of selector from _FASTQ_EPOLL or _FASTQ_SELECT"
-#endif
-
-#if !defined(_FASTQ_EPOLL) && !defined(_FASTQ_SELECT)
-# define _FASTQ_SELECT 1 //默认使用 select()
+ *  select 实时内核对 select 影响不严重，但只能等待小于 FD_SETSIZE 的 fd
+ *  poll 与 select 相同，没有 fd 大小的限制
+ *  futex 不使用 eventfd 和多路复用器，每个接收模块等待一个 futex，
+ *    发送方只在接收线程睡眠时 FUTEX_WAKE，唤醒路径上只有一次系统调用
+ *  io_uring 在门铃 eventfd 上挂多次触发的 poll，FastQGetFd 返回 io_uring 的 fd
+ *
+ *  每个接收模块只有一个门铃 (eventfd 或 futex)，哪些源模块的队列有消息见就绪位图 _ready */
+#if (defined(_FASTQ_EPOLL) + defined(_FASTQ_SELECT) + defined(_FASTQ_POLL) + \
+	defined(_FASTQ_FUTEX) + defined(_FASTQ_IO_URING)) > 1
+# error "You must choose one of selector from _FASTQ_EPOLL, _FASTQ_SELECT, _FASTQ_POLL, _FASTQ_FUTEX or _FASTQ_IO_URING"
 #endif
 
-#if !defined(_FASTQ_SELECT)
-# if !defined(_FASTQ_EPOLL)
-#  define _FASTQ_EPOLL 1
-# endif
+#if defined(_FASTQ_EPOLL)
+# define FASTQ_BACKEND_BUILTIN  FASTQ_BACKEND_EPOLL
+#elif defined(_FASTQ_POLL)
+# define FASTQ_BACKEND_BUILTIN  FASTQ_BACKEND_POLL
+#elif defined(_FASTQ_FUTEX)
+# define FASTQ_BACKEND_BUILTIN  FASTQ_BACKEND_FUTEX
+#elif defined(_FASTQ_IO_URING)
+# define FASTQ_BACKEND_BUILTIN  FASTQ_BACKEND_IO_URING
+#else
+# define FASTQ_BACKEND_BUILTIN  FASTQ_BACKEND_SELECT //默认使用 select()
 #endif
 
 /**
  *  内存分配器接口
  */
 #define FastQMalloc(size)   malloc(size)
+#define FastQMemalign(align, size)  memalign(align, size)
 #define FastQStrdup(str)    strdup(str)
 #define FastQFree(ptr)      free(ptr)
 
 
+#define min(a, b)	((a) < (b) ? (a) : (b))
 #define likely(x)	__builtin_expect(!!(x), 1)
 #define unlikely(x)	__builtin_expect(!!(x), 0)
 #define __cachelinealigned	__attribute__((aligned(64)))
 #define _unused	__attribute__((unused))
 
+/**
+ *  统计功能 (编译宏 _FASTQ_STATS 开启)
+ *
+ *  每个计数只有一个写者（入队数属于生产者，出队数属于消费者），
+ *  因此不需要 lock 前缀的原子指令，普通的 读-加-写 即可，
+ *  多入单出队列 的入队数除外
+ */
+#if defined(_FASTQ_STATS)
+typedef volatile unsigned long fastq_stat_t;
+# define __fastq_stat_add(stat, n)  \
+	__atomic_store_n(&(stat), (stat) + (n), __ATOMIC_RELAXED)
+# define __fastq_stat_add_mp(stat, n)  \
+	__atomic_fetch_add(&(stat), (n), __ATOMIC_RELAXED)
+#else
+# define __fastq_stat_add(stat, n)  do{}while(0)
+# define __fastq_stat_add_mp(stat, n)  do{}while(0)
+#endif
+
+/**
+ *  队列满时发送者的等待策略，见 __fastq_full_wait
+ *
+ *  先自旋 FASTQ_FULL_SPIN 次，再 sched_yield FASTQ_FULL_YIELD 次，
+ *  之后在 _head 上 futex 等待，消费者归还节点时唤醒；
+ *  消费者 写 _head -> 全屏障 -> 读等待标志，见 __fastq_head_wake，不会错过唤醒，
+ *  FASTQ_FULL_SLEEP_US 只是等待的上限
+ */
+#ifndef FASTQ_FULL_SPIN
+#define FASTQ_FULL_SPIN     1024
+#endif
+#ifndef FASTQ_FULL_YIELD
+#define FASTQ_FULL_YIELD    64
+#endif
+#ifndef FASTQ_FULL_SLEEP_US
+#define FASTQ_FULL_SLEEP_US 1000
+#endif
+
+/**
+ *  节点头： 实际发送大小字段 + msgType + msgCode + msgSubCode
+ *
+ *  msgType, msgCode, msgSubCode 的位宽由编译宏 FASTQ_HDR_FIELD_BITS 决定 (16/32/64, 见 fastq.h)，
+ *  默认 64 位；定义为 32 位时，8 字节消息的节点只占 32 字节，一个 cache line 放两个节点
+ */
+#if FASTQ_HDR_FIELD_BITS == 16
+typedef uint16_t fastq_hdr_field_t;
+#elif FASTQ_HDR_FIELD_BITS == 32
+typedef uint32_t fastq_hdr_field_t;
+#elif FASTQ_HDR_FIELD_BITS == 64
+typedef uint64_t fastq_hdr_field_t;
+#else
+# error "FASTQ_HDR_FIELD_BITS must be 16, 32 or 64"
+#endif
+
+struct fastq_node_hdr {
+	uint32_t size;
+	fastq_hdr_field_t type;
+	fastq_hdr_field_t code;
+	fastq_hdr_field_t subcode;
+};
+
+#define FASTQ_NODE_HDR_SIZE sizeof(struct fastq_node_hdr)
+
+/* msgType, msgCode, msgSubCode 是否都能放进消息头字段；64 位时编译为常量 true */
+#define __fastq_hdr_fits(type, code, subcode) \
+	((type) == (fastq_hdr_field_t)(type) && (code) == (fastq_hdr_field_t)(code) && \
+	 (subcode) == (fastq_hdr_field_t)(subcode))
+
+/* 变长队列 记录按 8 字节对齐，回绕时写入的填充记录的 size 字段 */
+#define FASTQ_VARLEN_ALIGN  8
+#define FASTQ_VARLEN_PAD    ((uint32_t)-1)
+
+#define __fastq_is_varlen(ring) ((ring)->_flags & FASTQ_MODULE_F_VARLEN)
+
+/* 变长队列 中消息大小为 size 的记录长度 */
+#define __fastq_varlen_len(size)  \
+	((FASTQ_NODE_HDR_SIZE + (size) + FASTQ_VARLEN_ALIGN - 1) & ~(FASTQ_VARLEN_ALIGN - 1))
+
+/**
+ *  多入单出队列 每个节点头之前保留 8 字节存放发布序号，
+ *  生产者写完节点后写入 位置+1，消费者看到序号等于 _head+1 才读取
+ */
+#define FASTQ_MP_SEQ_SIZE   8
+
+#define __fastq_is_mp(ring) ((ring)->_flags & FASTQ_MODULE_F_MPSC)
+#define __fastq_is_mc(ring) ((ring)->_flags & FASTQ_MODULE_F_MULTI_CONSUMER)
+#define __fastq_is_poll(ring)   ((ring)->_flags & FASTQ_MODULE_F_BUSY_POLL)
+#define __fastq_is_poll_only(ring)  ((ring)->_flags & FASTQ_MODULE_F_POLL_ONLY)
+
+/**
+ *  覆盖队列 (FASTQ_FULL_OVERWRITE) 内部标志，创建队列时由策略决定，不对外
+ *
+ *  生产者队列满时 CAS _head 丢弃最旧的消息，消费者也用 CAS 移动 _head，
+ *  节点之后多分配一个消费者私有节点，接收时先拷贝到这里
+ */
+#define FASTQ_RING_F_OVERWRITE  0x80000000UL
+#define __fastq_is_ow(ring) ((ring)->_flags & FASTQ_RING_F_OVERWRITE)
+#define __fastq_mp_seq(d)   (*(volatile uint32_t *)((d) - FASTQ_MP_SEQ_SIZE))
+
+/**
+ *  FastQRing._reconf: 其他线程修改了 src->dst 的配置，生产者发送时按新配置替换队列，
+ *  见 __fastq_ring_reconf
+ */
+#define FASTQ_RECONF_SIZE       0x1 //FastQConfigureEdge 修改了队列大小
+#define FASTQ_RECONF_POLICY     0x2 //FastQSetFullPolicy 修改了队列满策略
+
+/* 多入单出队列 位置 pos 处节点头的地址， pos 不回绕 */
+#define __fastq_mp_node(ring, pos)  \
+	(&(ring)->_ring_data[((pos) & (ring)->_size)*(ring)->_msg_size] + FASTQ_MP_SEQ_SIZE)
+
+/* 定长队列 一个节点能放下的最大消息 */
+#define __fastq_ring_payload_max(ring)  \
+	((ring)->_msg_size - FASTQ_NODE_HDR_SIZE - (__fastq_is_mp(ring) ? FASTQ_MP_SEQ_SIZE : 0))
+
 /**
  * The atomic counter structure.
  */
@@ -94,29 +253,243 @@ typedef enum  {
 	MODULE_STATUS_OK = MODULE_STATUS_REGISTED, //必须相等
 } module_status_t;
 
-// FastQRing
+struct FastQRing;
+
+/**
+ *  fastq_rcu_head - 等待读者退出后再处理的对象，放在对象开头，见 __fastq_call_rcu
+ */
+struct fastq_rcu_head {
+	struct fastq_rcu_head *next;
+	void (*func)(struct fastq_rcu_head *head);  //没有读者之后调用，一般是释放对象
+};
+
+/**
+ *  fastq_ring_rx - src->dst 消费者当前读取的队列，扩容后的新队列和高优先级队列共用
+ *
+ *  扩容后旧队列读空之前仍然是旧队列，见 __fastq_ring_migrate
+ */
+struct fastq_ring_rx {
+	struct fastq_rcu_head rcu;  //删除队列后等接收模块的 _rcu 读者退出再释放
+	struct FastQRing *volatile ring;
+};
+
+/**
+ *  FastQRing - 单入单出环形队列
+ *
+ *  字段按 "谁写" 分布在不同的 cache line 上：
+ *    生产者只写 _tail 和自己的私有行，消费者只写 _head 和自己的私有行，
+ *    双方各自缓存一份对方的下标，只有在队列看起来 满/空 时才去读对方的 cache line，
+ *    避免每条消息都在两个核之间来回传递 _head 和 _tail 所在的 cache line
+ *
+ *  多入单出队列 (FASTQ_MODULE_F_MPSC)：
+ *    _head/_tail 不回绕，生产者之间 CAS _tail 申请节点，逐个节点写入发布序号，
+ *    消费者只看节点的发布序号，不读 _tail
+ */
 struct FastQRing {
+	struct fastq_rcu_head rcu;  //删除 或 扩容后读空 的队列等接收模块的 _rcu 读者退出再释放
+
+	//只读字段，创建后不再修改
 	unsigned long src;  //是 1- FASTQ_ID_MAX 的任意值
 	unsigned long dst;  //是 1- FASTQ_ID_MAX 的任意值 二者不能重复
+	unsigned long _flags;   //FASTQ_MODULE_F_* 与目的模块一致，源模块的 MPSC 标志也会继承
+	unsigned int _size;     //定长队列: 节点数-1  变长队列: 字节数-1
+	size_t _msg_size;       //定长队列: 节点大小  变长队列: 最大记录大小
+	struct fastq_ring_rx *_rx;      //消费者当前读取的队列，创建队列时分配，删除队列时释放
+	volatile unsigned int _policy;  //FASTQ_FULL_* 队列满时的处理策略
+	volatile int _reconf;           //FASTQ_RECONF_*: 配置已修改，生产者下一次发送时生效
+	struct FastQRing *volatile _prio;   //高优先级队列，第一次 FastQSendPrio 时创建，共用 _rx
+	struct FastQRing *volatile _next;   //扩容后的新队列，旧队列读空后消费者切换过去
+
+	//生产者写，消费者读
+	struct {
+		volatile unsigned int _tail;
+	}__cachelinealigned;
+
+	//生产者等待空闲节点时写，消费者读，平时不写，见 __fastq_full_wait
+	struct {
+		volatile int _full_wait;
+	}__cachelinealigned;
+
+	//消费者读空队列后置 1，生产者看到 1 时置 0 并置目的模块的就绪位，见 __fastq_ring_notify
+	struct {
+		volatile int _armed;
+	}__cachelinealigned;
 
-	//统计字段
+	//生产者私有
 	struct {
-		atomic64_t nr_enqueue; //入队成功次数
-		atomic64_t nr_dequeue; //出队成功次数
+		unsigned int _head_cache;   //消费者 _head 的缓存，多入单出队列 由生产者共享
+		char *_reserved;            //FastQReserve 申请的节点，多入单出队列 不使用
+		unsigned long _dropped;     //按 _policy 丢弃的消息数（包括被覆盖的）
+		unsigned long _ow_gen;      //覆盖队列 生产者尝试 CAS _head 的次数
+#if defined(_FASTQ_STATS)
+		fastq_stat_t nr_enqueue;    //入队成功次数（包括后来被覆盖的）
+		fastq_stat_t nr_overwrite;  //覆盖队列 被覆盖的消息数，已计入 _dropped
+#endif
+	}__cachelinealigned;
+
+	//消费者写，生产者读
+	struct {
+		volatile unsigned int _head;
+	}__cachelinealigned;
+
+	//消费者私有
+	struct {
+		int _owner;                 //多消费者模式 下持有该队列的接收线程数 (0/1)
+		unsigned int _tail_cache;   //生产者 _tail 的缓存
+		unsigned int _head_next;    //__FastQRecvBurst 读取后的 _head
+#if defined(_FASTQ_STATS)
+		fastq_stat_t nr_dequeue;    //出队成功次数
+#endif
+	}__cachelinealigned;
+
+	char _ring_data[] __cachelinealigned;  //保存实际对象
+} __cachelinealigned;
+
+/**
+ *  广播队列 (FastQBroadcast)
+ *
+ *  每个源模块一个，单入多出：消息体只拷贝一次，每个接收模块是一个读者，
+ *  有自己的读位置，与源模块发往该接收模块的队列共用一个就绪位，
+ *  生产者只等待 被覆盖节点 的接收者中最慢的那个
+ *
+ *  节点： 发布序号 + 接收者掩码 + 节点头 + 消息体
+ *    序号等于 位置+1 时节点有效，生产者覆盖节点期间序号为新的位置，
+ *    读者读掩码前后各读一次序号，序号变化说明节点已被覆盖（一定不是发给自己的）
+ */
+#define FASTQ_BCAST_READER_MAX  64
+
+struct fastq_bcast_slot {
+	volatile uint32_t seq;
+	uint32_t __pad;
+	volatile uint64_t mask; //接收者掩码，第 i 位对应 _readers[i]
+};
+
+#define FASTQ_BCAST_SLOT_SIZE   sizeof(struct fastq_bcast_slot)
+
+#define __fastq_bcast_slot(bcast, pos)  \
+	((struct fastq_bcast_slot *)&(bcast)->_ring_data[((pos) & (bcast)->_size)*(bcast)->_msg_size])
+
+struct FastQBcastRing;
+
+/**
+ *  读者同时被生产者（源模块的 _rcu 保护）和接收模块（接收模块的 _rcu 保护）访问，
+ *  删除后先等源模块的读者退出，再等接收模块的读者退出，然后才释放，见 __fastq_bcast_retire
+ */
+struct FastQBcastReader {
+	struct fastq_rcu_head rcu;
+	struct FastQBcastRing *bcast;   //读者持有广播队列的一个引用
+	unsigned long src;  //源模块
+	unsigned long dst;  //接收模块
+	unsigned int idx;   //在 _readers 中的下标
+
+	//读者写，生产者读
+	struct {
+		volatile unsigned int _cursor;  //该位置之前 发给自己的消息都已处理
+		volatile int _full_wait;    //生产者等待 _cursor 时置 1，见 __fastq_cursor_wake
+	}__cachelinealigned;
+
+	//读者追上队尾后置 1，生产者看到 1 时置 0 并置接收模块的就绪位，见 FastQBroadcast
+	struct {
+		volatile int _armed;
+	}__cachelinealigned;
+} __cachelinealigned;
+
+struct FastQBcastRing {
+	struct fastq_rcu_head rcu;
+	//只读字段，创建后不再修改
+	unsigned long src;
+	unsigned int _size;     //节点数-1
+	size_t _msg_size;       //节点大小
+
+	volatile long _refs;    //源模块 一个 + 每个读者 一个，见 __fastq_bcast_put
+	pthread_mutex_t _lock;  //增删读者互斥
+
+	//生产者写，读者读
+	struct {
+		volatile unsigned int _tail;
+		volatile uint64_t _live;    //有效读者掩码
+	}__cachelinealigned;
+
+	//生产者私有
+	struct {
+		unsigned int _cursor_cache[FASTQ_BCAST_READER_MAX]; //读者 _cursor 的缓存
+		struct FastQBcastReader *_readers[FASTQ_BCAST_READER_MAX];
+		unsigned char _reader_of[FASTQ_ID_MAX+1];   //接收模块ID -> 下标+1
 	}__cachelinealigned;
 
-	unsigned int _size;
-	size_t _msg_size;
-	char _pad1[64];
-	volatile unsigned int _head;
-	char _pad2[64];
-	volatile unsigned int _tail;
-	char _pad3[64];
-	int _evt_fd;        //队列eventfd通知
-	char _ring_data[];  //保存实际对象
+	char _ring_data[] __cachelinealigned;
 } __cachelinealigned;
 
+/**
+ *  io_uring 后端 SQ 大小，写满时由写入 SQE 的线程直接提交
+ */
+#ifndef FASTQ_URING_ENTRIES
+#define FASTQ_URING_ENTRIES 1024
+#endif
+
+/**
+ *  FastQUring - 接收模块的 io_uring
+ *
+ *  只 poll 模块的门铃，poll 的完成由提交它的线程执行，SQE 由接收线程在下一次等待前提交；
+ *  随模块槽位保留，删除模块时不释放
+ */
+struct FastQUring {
+	pthread_mutex_t lock;   //保护 SQ 的写入 和 CQ 的收割
+	int fd;
+	unsigned int gen;       //门铃移出 io_uring 的次数，区分复用同一个 fd 号的旧 poll
+	unsigned int pending;   //已写入 SQ 还没有提交的 SQE 数
+	unsigned int sq_entries;
+	unsigned int sq_mask;
+	unsigned int cq_mask;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+};
+
 //模块
+/**
+ *  fastq_edge - 某个源模块发往该模块的队列配置，0 表示使用模块的 msgMax/msgSize
+ */
+struct fastq_edge {
+	unsigned int msg_max;   //消息数
+	unsigned int msg_size;  //消息大小
+	unsigned int policy;    //FASTQ_FULL_* + 1，0 表示使用模块的 policy
+};
+
+struct fastq_backend;
+
+/**
+ *  fastq_id_list - 活跃队列列表: 有序、紧凑的对端模块ID数组（广播读者列表中是读者地址）
+ *
+ *  只读，修改时复制一份新的替换，旧列表挂到 fastq_rcu.retired 上，没有读者时释放，
+ *  见 __fastq_list_update __fastq_rcu_read_lock
+ */
+struct fastq_id_list {
+	struct fastq_rcu_head rcu;
+	unsigned int nr;
+	unsigned long id[];
+};
+
+/**
+ *  fastq_rcu - 保护 fastq_id_list、广播读者 和 接收队列 的读者计数
+ *
+ *  读者只增减计数，不加锁、不等待；写者互斥，替换列表后不等待读者，
+ *  旧对象由看到计数为 0 的写者或最后一个退出的读者处理，见 __fastq_call_rcu
+ */
+struct fastq_rcu {
+	volatile long readers;
+	struct fastq_rcu_head *volatile retired;
+	pthread_mutex_t lock;   //写者互斥
+};
+
+/**
+ *  就绪位图 的字数，每个源模块ID（包括 0）一位
+ */
+#define FASTQ_READY_WORDS   ((FASTQ_ID_MAX + 64) / 64)
+
 struct FastQModule {
 	/* 将用于使用模块名发送消息的接口 */
 	char *name;             /* 模块名 */
@@ -127,19 +500,19 @@ struct FastQModule {
 	module_status_t status; /* 模块状态 TODO */
 
 	struct {    /* 多路复用器 */
-		union{
-			int epfd;   /* epoll_create() */
-			struct {    /* select() */
-			int maxfd;
-			pthread_rwlock_t rwlock;    // 保护 fd_set
-			fd_set readset;
-			} selector;
-		};
-		int notify_new_enqueue_evt_fd;  /*  */
+		const struct fastq_backend *backend;    /* 注册时选择，见 FastQModuleAttr.backend */
+		int epfd;   /* epoll_create() */
+		struct FastQUring *uring;   /* io_uring，第一次使用时创建，随模块槽位保留 */
+		int notify_new_enqueue_evt_fd;  /* 门铃，futex 后端 为 -1 */
 	};
 	unsigned long module_id;//是 1- FASTQ_ID_MAX 的任意值
-	unsigned int ring_size; //队列大小，ring 节点数
+	unsigned long flags;    //FASTQ_MODULE_F_* 见 FastQModuleAttr
+	volatile long _prio_pending;    //所有队列中尚未处理的高优先级消息数
+	unsigned int ring_size; //队列大小，定长队列: ring 节点数  变长队列: ring 字节数
+	unsigned int ring_max;  //FASTQ_MODULE_F_AUTO_GROW 扩容上限，单位同 ring_size
 	unsigned int msg_size;  //消息大小， ring 节点大小
+	unsigned int policy;    //FASTQ_FULL_* 见 FastQModuleAttr
+	unsigned int poll_us;   //FASTQ_MODULE_F_BUSY_POLL 空转的微秒数
 
 	char *_file;    //调用注册函数的 文件名
 	char *_func;    //调用注册函数的 函数名
@@ -151,9 +524,54 @@ struct FastQModule {
 	} rx, tx;        //发送和接收
 
 	struct FastQRing **_ring;   /* 环形队列 */
+	struct fastq_id_list *volatile _rx_list;    /* 有发往该模块的队列的源模块 */
+	struct fastq_id_list *volatile _tx_list;    /* 该模块有队列发往的目的模块 */
+	struct fastq_id_list *volatile _bcast_list; /* 该模块的广播读者 (struct FastQBcastReader *) */
+	struct fastq_edge *_edge;   /* 按源模块配置的队列大小，见 FastQConfigureEdge */
+	struct FastQBcastRing *_bcast;  /* 广播队列，第一次 FastQBroadcast 时创建 (CAS) */
+
+	//生产者置位，接收线程取走，见 __fastq_module_ready __fastq_ready_dispatch
+	struct {
+		volatile uint64_t _ready[FASTQ_READY_WORDS];    //第 src 位: src 发来的队列或广播有消息
+	}__cachelinealigned;
+
+	//接收线程写，生产者读，见 __fastq_module_notify
+	struct {
+		volatile int _sleeping;     //接收线程没有在接收，生产者需要敲门铃 (eventfd 或 FUTEX_WAKE)
+		volatile int _futex;        //futex 后端 接收线程等待的字，每次唤醒加 1
+		volatile int _waiting;      //在 backend->wait 中的接收线程数，删除模块等它们退出再关闭 fd
+	}__cachelinealigned;
+
+	//忙轮询的接收线程每次轮询都写，统计、删除等读者偶尔写
+	struct fastq_rcu _rcu __cachelinealigned;   //保护 _rx_list _tx_list _bcast_list 和 _ring[]
+
+	//接收线程私有
+	struct {
+		unsigned long _poll_src;    //忙轮询模式 下一次从 _rx_list 的哪个下标开始轮询，见 __fastq_poll_sweep
+		unsigned long _ready_word;  //下一次从哪个 _ready 字开始扫描，见 __fastq_ready_dispatch
+	}__cachelinealigned;
 
 } __cachelinealigned;
 
+/**
+ *  fastq_backend - 接收模块的通知后端（门铃），见 FASTQ_BACKEND_*
+ *
+ *  init/fini   注册/删除模块时将门铃加入/移出多路复用器
+ *  wait        等待门铃最多 timeout_ms 毫秒，可读返回 1，超时返回 0，出错返回 -1
+ *  ack         清空门铃
+ *  fd          FastQGetFd 返回的 fd
+ *
+ *  futex 后端 没有 eventfd，wait 为 NULL，见 __fastq_doorbell_wait
+ */
+struct fastq_backend {
+	unsigned int type;  //FASTQ_BACKEND_*
+	void (*init)(struct FastQModule *pmodule);
+	void (*fini)(struct FastQModule *pmodule);
+	int (*wait)(struct FastQModule *pmodule, int timeout_ms);
+	void (*ack)(struct FastQModule *pmodule);
+	int (*fd)(struct FastQModule *pmodule);
+};
+
 
 static uint64_t _unused dictSdsCaseHash(const void *key) {
 	return dictGenCaseHashFunction((unsigned char*)key, sdslen((char*)key));
@@ -288,6 +706,19 @@ atomic64_inc(atomic64_t *v) {
 			);
 }
 
+/**
+ *  __fastq_node_stride - 定长队列 节点步长
+ *
+ *  小于一个 cache line 的节点取 16/32/64 字节，保证 cache line 内能放整数个节点，
+ *  大节点取 64 的整数倍
+ */
+static unsigned long _unused
+__fastq_node_stride(unsigned long node_size) {
+	if (node_size <= 16) return 16;
+	if (node_size <= 32) return 32;
+	return (node_size + 63) & ~63UL;
+}
+
 static unsigned int  _unused
 __power_of_2(unsigned int size) {
 	unsigned int i;
@@ -295,6 +726,29 @@ __power_of_2(unsigned int size) {
 	return 1U << i;
 }
 
+/**
+ *  __fastq_varlen_bytes - 变长队列 的字节数
+ *
+ *  向上取 2 的幂，至少能放下两条最大的记录，保证回绕时总能放下一条记录
+ */
+static unsigned int
+__fastq_varlen_bytes(unsigned int bytes, unsigned int msg_size) {
+	unsigned int min_bytes = 2 * __power_of_2(__fastq_varlen_len(msg_size));
+
+	bytes = __power_of_2(bytes);
+	return bytes < min_bytes ? min_bytes : bytes;
+}
+
+/**
+ *  __fastq_edge_msg_size - src 发往该模块的队列的消息大小
+ */
+static inline unsigned int
+__fastq_edge_msg_size(struct FastQModule *pmodule, const unsigned long src) {
+	struct fastq_edge *edge = __atomic_load_n(&pmodule->_edge, __ATOMIC_ACQUIRE);
+
+	return (edge && edge[src].msg_size) ? edge[src].msg_size : pmodule->msg_size;
+}
+
 #define fastq_log(fmt...) do{           \
 				fprintf(fastq_log_fp, fmt); \
 				fflush(fastq_log_fp);       \
@@ -313,286 +767,1365 @@ static struct FastQModule *_AllModulesRings = NULL;
 //只在注册时保护使用
 static pthread_rwlock_t _AllModulesRingsLock = PTHREAD_RWLOCK_INITIALIZER;
 
-// 从 event fd 查找 ring 的最快方法
-static  struct {
-	struct FastQRing *tlb_ring;
-}__cachelinealigned _evtfd_to_ring[FD_SETSIZE] = {{NULL}};
+//已注册的模块
+static struct fastq_id_list *volatile _AllModulesList = NULL;
+static struct fastq_rcu _AllModulesListRcu = {
+	.readers = 0,
+	.retired = NULL,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
 
+/**
+ *  __fastq_rcu_enter - 读者: 开始读，之后读到的对象在 __fastq_rcu_read_unlock 之前不会被释放
+ *
+ *  先增加计数再读对象，与写者 替换对象 -> 读计数 配对（都是 SEQ_CST），
+ *  写者看到计数为 0 时，之后的读者一定读到新对象；读的过程中可以调用消息处理函数、修改列表
+ */
+static inline void
+__fastq_rcu_enter(struct fastq_rcu *rcu)
+{
+	__atomic_add_fetch(&rcu->readers, 1, __ATOMIC_SEQ_CST);
+}
 
-static void  __fastq_log_init() {
-	char fasgq_log_file[256] = {"./.fastq.log"};    //这将是个隐藏文件
-	fastq_log_fp = fopen(fasgq_log_file, "w");
-	fastq_log_fp = fastq_log_fp?fastq_log_fp:stderr;
+/**
+ *  __fastq_rcu_read_lock - 读者: 开始读 *plist，返回当前列表，NULL 表示空
+ */
+static inline struct fastq_id_list *
+__fastq_rcu_read_lock(struct fastq_rcu *rcu, struct fastq_id_list *volatile *plist)
+{
+	__fastq_rcu_enter(rcu);
+	return __atomic_load_n(plist, __ATOMIC_SEQ_CST);
 }
 
 /**
- *  FastQ 初始化 函数，初始化 _AllModulesRings 全局变量
+ *  __fastq_rcu_reclaim - 没有读者时处理所有旧对象，其他线程持有写锁时由它处理
  */
-static void __attribute__((constructor(105))) __FastQInitCtor() {
-	int i, j;
+static void
+__fastq_rcu_reclaim(struct fastq_rcu *rcu)
+{
+	struct fastq_rcu_head *head, *next;
 
-	__fastq_log_init();
+	if (pthread_mutex_trylock(&rcu->lock)) {
+		return;
+	}
+	head = rcu->retired;
+	if (head && !__atomic_load_n(&rcu->readers, __ATOMIC_SEQ_CST)) {
+		rcu->retired = NULL;
+	} else {
+		head = NULL;
+	}
+	pthread_mutex_unlock(&rcu->lock);
 
-	_AllModulesRings = FastQMalloc(sizeof(struct FastQModule)*(FASTQ_ID_MAX+1));
+	for (; head; head = next) {
+		next = head->next;
+		head->func(head);
+	}
+}
 
-	for (i = 0; i <= FASTQ_ID_MAX; i++) {
+/**
+ *  __fastq_call_rcu - 写者: 对象已经不可见，等 rcu 当前的读者都退出后调用 func(head)
+ */
+static void
+__fastq_call_rcu(struct fastq_rcu *rcu, struct fastq_rcu_head *head,
+		void (*func)(struct fastq_rcu_head *head))
+{
+	head->func = func;
 
-		struct FastQModule *this_module = &_AllModulesRings[i];
+	pthread_mutex_lock(&rcu->lock);
+	head->next = rcu->retired;
+	rcu->retired = head;
+	pthread_mutex_unlock(&rcu->lock);
 
-		__atomic_store_n(&this_module->already_register, false, __ATOMIC_RELEASE);
-		__atomic_store_n(&this_module->status, MODULE_STATUS_INVALIDE, __ATOMIC_RELEASE);
-		__atomic_store_n(&this_module->name_attached, false, __ATOMIC_RELEASE);
+	__fastq_rcu_reclaim(rcu);
+}
 
-		this_module->module_id = i;
+static void
+__fastq_id_list_free(struct fastq_rcu_head *head)
+{
+	FastQFree(head);
+}
 
-#if defined(_FASTQ_EPOLL)
+/**
+ *  __fastq_ring_release - 释放 FastQRing 或 fastq_ring_rx，rcu 都在对象开头
+ */
+static void
+__fastq_ring_release(struct fastq_rcu_head *head)
+{
+	FastQFree(head);
+}
 
-		this_module->epfd = -1;
+/**
+ *  __fastq_rcu_read_unlock - 读者: 读完，最后一个读者释放旧列表
+ */
+static inline void
+__fastq_rcu_read_unlock(struct fastq_rcu *rcu)
+{
+	if (!__atomic_sub_fetch(&rcu->readers, 1, __ATOMIC_SEQ_CST) &&
+		unlikely(__atomic_load_n(&rcu->retired, __ATOMIC_RELAXED))) {
+		__fastq_rcu_reclaim(rcu);
+	}
+}
 
-#elif defined(_FASTQ_SELECT)
+/**
+ *  __fastq_rcu_quiesce - 长时间持有计数的读者: 有等待释放的旧对象时退出再重新进入
+ *
+ *  之前读到的对象之后不能再使用，需要重新读
+ */
+static inline void
+__fastq_rcu_quiesce(struct fastq_rcu *rcu)
+{
+	if (unlikely(__atomic_load_n(&rcu->retired, __ATOMIC_RELAXED))) {
+		__fastq_rcu_read_unlock(rcu);
+		__fastq_rcu_enter(rcu);
+	}
+}
 
-		FD_ZERO(&this_module->selector.readset);
-		this_module->selector.maxfd    = 0;
-		pthread_rwlock_init(&this_module->selector.rwlock, NULL);
+/**
+ *  __fastq_list_update - 写者: 向 *plist 中加入或删除 id，复制一份新列表替换
+ */
+static void
+__fastq_list_update(struct fastq_rcu *rcu, struct fastq_id_list *volatile *plist,
+		unsigned long id, bool add)
+{
+	struct fastq_id_list *old, *new = NULL;
+	unsigned int i, j, nr;
 
-#endif
-		this_module->notify_new_enqueue_evt_fd = -1;
+	pthread_mutex_lock(&rcu->lock);
 
-		//清空   rx 和 tx set
-		MOD_ZERO(&this_module->rx.set);
-		MOD_ZERO(&this_module->tx.set);
-		pthread_rwlock_init(&this_module->rx.rwlock, NULL);
-		pthread_rwlock_init(&this_module->tx.rwlock, NULL);
+	old = *plist;
+	nr = old ? old->nr : 0;
 
-		//清空 ring
-		this_module->ring_size = 0;
-		this_module->msg_size = 0;
+	for (i = 0; i < nr && old->id[i] < id; i++);
 
-		//分配所有 ring 指针
-		struct FastQRing **___ring = FastQMalloc(sizeof(struct FastQRing*)*(FASTQ_ID_MAX+1));
-		assert(___ring && "Malloc Failed: Out of Memory.");
+	if (add == (i < nr && old->id[i] == id)) {
+		/* 已经存在 或 不存在 */
+		pthread_mutex_unlock(&rcu->lock);
+		return;
+	}
 
-		this_module->_ring = ___ring;
-		for (j = 0; j <= FASTQ_ID_MAX; j++) {
-			__atomic_store_n(&this_module->_ring[j], NULL, __ATOMIC_RELAXED);
+	if (add || nr > 1) {
+		new = FastQMalloc(sizeof(struct fastq_id_list) +
+				sizeof(new->id[0]) * (add ? nr + 1 : nr - 1));
+		assert(new && "Malloc Failed: Out of Memory.");
+
+		new->nr = add ? nr + 1 : nr - 1;
+
+		for (j = 0; j < i; j++) {
+			new->id[j] = old->id[j];
+		}
+		if (add) {
+			new->id[j++] = id;
+		} else {
+			i++;
+		}
+		for (; i < nr; i++, j++) {
+			new->id[j] = old->id[i];
 		}
 	}
+	__atomic_store_n(plist, new, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&rcu->lock);
 
-	dict_init();
+	if (old) {
+		__fastq_call_rcu(rcu, &old->rcu, __fastq_id_list_free);
+	}
 }
 
+#define __fastq_list_add(rcu, plist, id)    __fastq_list_update(rcu, plist, id, true)
+#define __fastq_list_del(rcu, plist, id)    __fastq_list_update(rcu, plist, id, false)
 
-/******************************************************************************
- *  原始接口
- *****************************************************************************/
-static void
-__fastq_create_ring(struct FastQModule *pmodule, const unsigned long src,
-	const unsigned long dst) {
-
-	const unsigned int ring_size = pmodule->ring_size;
-	const unsigned int msg_size = pmodule->msg_size;
+/**
+ *  __fastq_edge_varlen - src 发往该模块的队列是否为 变长队列
+ *
+ *  多入单出队列 不支持变长，源模块或目的模块设置了 FASTQ_MODULE_F_MPSC 时退化为定长队列
+ */
+static inline bool
+__fastq_edge_varlen(struct FastQModule *pmodule, const unsigned long src) {
+	return (pmodule->flags & FASTQ_MODULE_F_VARLEN) &&
+		!((pmodule->flags | _AllModulesRings[src].flags) & FASTQ_MODULE_F_MPSC);
+}
 
-	fastq_log("Create ring : src(%lu)->dst(%lu) ringsize(%d) msgsize(%d).\n",
-		src, dst, ring_size, msg_size);
+/**
+ *  __fastq_edge_ring_size - src 发往该模块的队列大小，变长队列 为字节数，定长队列 为节点数
+ */
+static unsigned int
+__fastq_edge_ring_size(struct FastQModule *pmodule, const unsigned long src) {
+	struct fastq_edge *edge = __atomic_load_n(&pmodule->_edge, __ATOMIC_ACQUIRE);
+	const unsigned int msg_size = __fastq_edge_msg_size(pmodule, src);
+
+	if (!__fastq_edge_varlen(pmodule, src)) {
+		if (edge && edge[src].msg_max) {
+			return __power_of_2(edge[src].msg_max);
+		}
+		if (pmodule->flags & FASTQ_MODULE_F_VARLEN) {
+			/* 退化的定长队列: 模块的 ring_size 是字节数，按最大消息折算成节点数 */
+			return __power_of_2(pmodule->ring_size / __fastq_varlen_len(msg_size));
+		}
+		return pmodule->ring_size;
+	}
+	if (edge && edge[src].msg_max) {
+		return __fastq_varlen_bytes(edge[src].msg_max * __fastq_varlen_len(msg_size), msg_size);
+	}
+	return __fastq_varlen_bytes(pmodule->ring_size, msg_size);
+}
 
-	/* 消息大小 + 实际发送大小字段 + msgType + msgCode + msgSubCode, */
-	unsigned long ring_node_size = msg_size + sizeof(size_t) + sizeof(unsigned long)*3;
+/**
+ *  __fastq_edge_policy_set - src 发往该模块的队列满时的处理策略（配置值）
+ */
+static inline unsigned int
+__fastq_edge_policy_set(struct FastQModule *pmodule, const unsigned long src) {
+	struct fastq_edge *edge = __atomic_load_n(&pmodule->_edge, __ATOMIC_ACQUIRE);
 
-	unsigned long ring_real_size = sizeof(struct FastQRing) + ring_size*(ring_node_size);
+	return (edge && edge[src].policy) ? edge[src].policy - 1 : pmodule->policy;
+}
 
-	struct FastQRing *new_ring = FastQMalloc(ring_real_size);
-	assert(new_ring && "Allocate FastQRing Failed. (OOM error)");
+/**
+ *  __fastq_edge_policy - src 发往该模块的队列满时的处理策略
+ *
+ *  覆盖队列 只支持定长的单入单出队列；FastQSetFullPolicy 和 FastQCreateModuleAttr 拒绝
+ *  多入单出队列 的覆盖策略，只有目的模块默认覆盖、源模块是 多入单出 时
+ *  退化为 FASTQ_FULL_DROP_NEWEST，创建队列时记录日志
+ */
+static unsigned int
+__fastq_edge_policy(struct FastQModule *pmodule, const unsigned long src) {
+	unsigned int policy = __fastq_edge_policy_set(pmodule, src);
 
-	memset(new_ring, 0x00, ring_real_size);
+	if (policy == FASTQ_FULL_OVERWRITE &&
+		((pmodule->flags | _AllModulesRings[src].flags) & FASTQ_MODULE_F_MPSC)) {
+		policy = FASTQ_FULL_DROP_NEWEST;
+	}
+	return policy;
+}
 
-	new_ring->src = src;
-	new_ring->dst = dst;
-	new_ring->_size = ring_size - 1;
+/**
+ *  __fastq_is_futex_module - 模块是否使用 futex 后端，没有 eventfd 和多路复用器
+ */
+#define __fastq_is_futex_module(pmodule)  \
+	((pmodule)->backend->type == FASTQ_BACKEND_FUTEX)
 
-	new_ring->_msg_size = ring_node_size;
-	new_ring->_evt_fd = eventfd(0, EFD_CLOEXEC);
-	assert(new_ring->_evt_fd && "Too much eventfd called, no fd to use.");
+/**
+ *  __fastq_evt_open - 创建 pmodule 的门铃 eventfd
+ *
+ *  futex 后端 不创建 eventfd，返回 -1；
+ *  多个接收线程、外部事件循环 都可能读门铃，门铃总是非阻塞的
+ */
+static int
+__fastq_evt_open(struct FastQModule *pmodule)
+{
+	int fd;
 
-	/* fd->ring 的快表 更应该是空的 */
-	if (likely(!__atomic_load_n(&_evtfd_to_ring[new_ring->_evt_fd].tlb_ring, __ATOMIC_RELAXED))) {
-		__atomic_store_n(&_evtfd_to_ring[new_ring->_evt_fd].tlb_ring, new_ring, __ATOMIC_RELAXED);
+	if (__fastq_is_futex_module(pmodule)) {
+		return -1;
 	}
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	assert(fd >= 0 && "Too much eventfd called, no fd to use.");
 
-#if defined(_FASTQ_EPOLL)
+	return fd;
+}
 
-	struct epoll_event event;
-	event.data.fd = new_ring->_evt_fd;
-	event.events = EPOLLIN; //必须采用水平触发
-	epoll_ctl(pmodule->epfd, EPOLL_CTL_ADD, event.data.fd, &event);
+static void
+__fastq_evt_close(int fd)
+{
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+/**
+ *  __fastq_module_kick - 敲接收模块的门铃，唤醒接收线程（有消息、模块被删除等）
+ */
+static void
+__fastq_module_kick(struct FastQModule *pmodule)
+{
+	if (__fastq_is_futex_module(pmodule)) {
+		__atomic_add_fetch(&pmodule->_futex, 1, __ATOMIC_RELEASE);
+		/* 多消费者模式 可能有多个接收线程在等待 */
+		syscall(SYS_futex, &pmodule->_futex, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+	} else {
+		eventfd_write(pmodule->notify_new_enqueue_evt_fd, 1);
+	}
+}
 
-#elif defined(_FASTQ_SELECT)
+/**
+ *  __fastq_module_notify - 生产者: 发布节点之后，接收线程睡眠时敲门铃
+ *
+ *  与 __fastq_recv_sleep 配对，多个生产者同时看到 _sleeping 时只有一个敲门铃
+ */
+static inline void
+__fastq_module_notify(struct FastQModule *pmodule)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
 
-	pthread_rwlock_wrlock(&pmodule->selector.rwlock);
-	FD_SET(new_ring->_evt_fd, &pmodule->selector.readset);
-	if(new_ring->_evt_fd > pmodule->selector.maxfd) {
-		pmodule->selector.maxfd = new_ring->_evt_fd;
+	if (likely(!__atomic_load_n(&pmodule->_sleeping, __ATOMIC_RELAXED))) {
+		return;
+	}
+	if (__atomic_exchange_n(&pmodule->_sleeping, 0, __ATOMIC_ACQUIRE)) {
+		__fastq_module_kick(pmodule);
 	}
-	pthread_rwlock_unlock(&pmodule->selector.rwlock);
+}
 
-#endif
+/**
+ *  __fastq_ready_mark - 置 src 的就绪位，不敲门铃
+ */
+static inline void
+__fastq_ready_mark(struct FastQModule *pmodule, unsigned long src)
+{
+	/* 动态删除模块时，可能导致 src 失效，见 __fastq_ring_drain */
+	if (unlikely(src > FASTQ_ID_MAX)) {
+		return;
+	}
+	__atomic_fetch_or(&pmodule->_ready[src / 64], 1UL << (src % 64), __ATOMIC_SEQ_CST);
+}
 
-	//统计功能
-	atomic64_init(&new_ring->nr_dequeue);
-	atomic64_init(&new_ring->nr_enqueue);
+/**
+ *  __fastq_module_ready - 生产者: 置 src 的就绪位，必要时敲门铃
+ *
+ *  单个接收线程 只在它睡眠 (_sleeping) 时敲门铃；
+ *  多消费者模式 每次置位都敲，每个睡眠的接收线程都有机会取走一个队列
+ */
+static inline void
+__fastq_module_ready(struct FastQModule *pmodule, unsigned long src)
+{
+	__fastq_ready_mark(pmodule, src);
 
-	__atomic_store_n(&pmodule->_ring[src], new_ring, __ATOMIC_RELAXED);
+	if (pmodule->flags & FASTQ_MODULE_F_MULTI_CONSUMER) {
+		__fastq_module_kick(pmodule);
+	} else {
+		__fastq_module_notify(pmodule);
+	}
+}
+
+/* POLL_REMOVE 自身的 CQE */
+#define FASTQ_URING_DATA_NONE   (~0ULL)
+
+static inline int
+__fastq_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+		unsigned int flags, void *arg, size_t argsz)
+{
+	return syscall(SYS_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+/**
+ *  __fastq_uring_create - 创建接收模块的 io_uring 并映射 SQ/CQ
+ */
+static struct FastQUring *
+__fastq_uring_create(void)
+{
+	struct FastQUring *u = FastQMalloc(sizeof(struct FastQUring));
+	struct io_uring_params p;
+	size_t sq_sz, cq_sz;
+	char *sq, *cq;
+	unsigned int i, *array;
+
+	assert(u && "Malloc Failed: Out of Memory.");
+
+	memset(&p, 0, sizeof(p));
+	u->fd = syscall(SYS_io_uring_setup, FASTQ_URING_ENTRIES, &p);
+	assert(u->fd >= 0 && "io_uring_setup error");
+	assert((p.features & IORING_FEAT_NODROP) && (p.features & IORING_FEAT_EXT_ARG) &&
+			"io_uring: kernel too old (need 5.11+)");
+
+	sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		sq_sz = cq_sz = sq_sz > cq_sz ? sq_sz : cq_sz;
+	}
+	sq = mmap(NULL, sq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+				u->fd, IORING_OFF_SQ_RING);
+	assert(sq != MAP_FAILED && "io_uring mmap error");
+	cq = sq;
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+		cq = mmap(NULL, cq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+				u->fd, IORING_OFF_CQ_RING);
+		assert(cq != MAP_FAILED && "io_uring mmap error");
+	}
+	u->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ|PROT_WRITE,
+				MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	assert(u->sqes != MAP_FAILED && "io_uring mmap error");
+
+	u->sq_entries = p.sq_entries;
+	u->sq_mask = *(unsigned int *)(sq + p.sq_off.ring_mask);
+	u->sq_head = (unsigned int *)(sq + p.sq_off.head);
+	u->sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+	u->cq_mask = *(unsigned int *)(cq + p.cq_off.ring_mask);
+	u->cq_head = (unsigned int *)(cq + p.cq_off.head);
+	u->cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+	u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	/* SQE 按顺序使用，下标数组固定 */
+	array = (unsigned int *)(sq + p.sq_off.array);
+	for (i = 0; i < p.sq_entries; i++) {
+		array[i] = i;
+	}
+
+	u->gen = 0;
+	u->pending = 0;
+	pthread_mutex_init(&u->lock, NULL);
+
+	return u;
 }
 
+/**
+ *  __fastq_uring_submit - 提交 SQ 中所有未提交的 SQE，调用者持有 lock
+ */
+static inline void
+__fastq_uring_submit(struct FastQUring *u)
+{
+	if (u->pending) {
+		__fastq_uring_enter(u->fd, u->pending, 0, 0, NULL, 0);
+		u->pending = 0;
+	}
+}
 
+/**
+ *  __fastq_uring_poll - 写入门铃 fd 的 POLL_ADD(多次触发) 或 POLL_REMOVE，调用者持有 lock
+ *
+ *  user_data 为 gen << 32 | fd，移除时 gen 加一，旧 poll 的 CQE 直接丢弃
+ */
 static void
-__fastq_destroy_ring(struct FastQModule *pmodule, const unsigned long src,
-	const unsigned long dst) {
+__fastq_uring_poll(struct FastQUring *u, int fd, bool add)
+{
+	uint64_t data = (uint64_t)u->gen << 32 | (unsigned int)fd;
+	unsigned int tail = *u->sq_tail;
+	struct io_uring_sqe *sqe;
 
-	struct FastQRing *this_ring = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_RELAXED);
+	if (unlikely(tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries)) {
+		/* SQ 满了，由当前线程直接提交 */
+		__fastq_uring_submit(u);
+	}
 
-	fastq_log("Destroy ring : src(%lu)->dst(%lu) ringsize(%d) msgsize(%d).\n",
-					src, dst, pmodule->ring_size, pmodule->msg_size);
+	sqe = &u->sqes[tail & u->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	if (add) {
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = fd;
+		sqe->poll32_events = POLLIN;
+		sqe->len = IORING_POLL_ADD_MULTI;
+		sqe->user_data = data;
+	} else {
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = data;
+		sqe->user_data = FASTQ_URING_DATA_NONE;
+		u->gen++;
+	}
+	__atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	u->pending++;
+}
+
+/**
+ *  __fastq_uring_reap - 收割 CQ 中所有的完成，返回门铃就绪的次数，调用者持有 lock
+ *
+ *  poll 结束（CQ 溢出、提交线程退出等）时重新写入 POLL_ADD，并按就绪处理一次
+ */
+static int
+__fastq_uring_reap(struct FastQUring *u)
+{
+	unsigned int head = *u->cq_head;
+	unsigned int tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	struct io_uring_cqe *cqe;
+	int n = 0;
 
-	atomic64_init(&this_ring->nr_dequeue);
-	atomic64_init(&this_ring->nr_enqueue);
+	for (; head != tail; head++) {
+		cqe = &u->cqes[head & u->cq_mask];
 
-#if defined(_FASTQ_EPOLL)
+		if (cqe->user_data == FASTQ_URING_DATA_NONE ||
+			(unsigned int)(cqe->user_data >> 32) != u->gen) {
+			continue;
+		}
+		/* 多次触发的 poll 已经结束（包括出错），重新添加，否则这个门铃再也收不到 */
+		if (unlikely(!(cqe->flags & IORING_CQE_F_MORE))) {
+			__fastq_uring_poll(u, (int)(unsigned int)cqe->user_data, true);
+		}
+		if (unlikely(cqe->res < 0 && cqe->res != -ECANCELED)) {
+			fastq_log("ERROR: io_uring poll fd %d failed: %s.\n",
+				(int)(unsigned int)cqe->user_data, strerror(-cqe->res));
+			continue;
+		}
+		n++;
+	}
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
 
-	epoll_ctl(pmodule->epfd, EPOLL_CTL_DEL, this_ring->_evt_fd, NULL);
+	return n;
+}
 
-#elif defined(_FASTQ_SELECT)
+/**
+ *  __fastq_uring_wait - 等待门铃最多 timeout_ms 毫秒
+ *
+ *  等待时不持有 lock，多消费者模式 下多个接收线程可以同时等待
+ */
+static int
+__fastq_uring_wait(struct FastQUring *u, int timeout_ms)
+{
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	int n;
 
-	pthread_rwlock_wrlock(&pmodule->selector.rwlock);
-	FD_CLR(this_ring->_evt_fd, &pmodule->selector.readset);
-	pthread_rwlock_unlock(&pmodule->selector.rwlock);
-	pthread_rwlock_destroy(&pmodule->selector.rwlock);
+	pthread_mutex_lock(&u->lock);
+	__fastq_uring_submit(u);
+	n = __fastq_uring_reap(u);
+	pthread_mutex_unlock(&u->lock);
 
-#endif
+	if (n || !timeout_ms) {
+		return n;
+	}
 
-	if (likely(__atomic_load_n(&_evtfd_to_ring[this_ring->_evt_fd].tlb_ring, __ATOMIC_RELAXED))) {
-		__atomic_store_n(&_evtfd_to_ring[this_ring->_evt_fd].tlb_ring, NULL, __ATOMIC_RELAXED);
+	memset(&arg, 0, sizeof(arg));
+	if (timeout_ms > 0) {
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+		arg.ts = (uint64_t)(uintptr_t)&ts;
 	}
+	__fastq_uring_enter(u->fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+			&arg, sizeof(arg));
 
-	close(this_ring->_evt_fd);
-	FastQFree(this_ring);
+	pthread_mutex_lock(&u->lock);
+	n = __fastq_uring_reap(u);
+	pthread_mutex_unlock(&u->lock);
 
-	__atomic_store_n(&pmodule->_ring[src], NULL, __ATOMIC_RELEASE);
+	return n;
 }
 
+/******************************************************************************
+ *  通知后端
+ *****************************************************************************/
+static void
+__fastq_nop_init(struct FastQModule _unused *pmodule)
+{
+}
 
-void
-FastQCreateModuleDump(const unsigned long module_id,
-						const mod_set *rxset, const mod_set *txset,
-						const unsigned int ring_size, const unsigned int msg_size,
-						const char *_file, const char *_func, const int _line)
+static int
+__fastq_nop_fd(struct FastQModule _unused *pmodule)
 {
-	assert(module_id <= FASTQ_ID_MAX && "Module ID out of range");
+	return -1;
+}
 
-	if(unlikely(!_file) || unlikely(!_func) || unlikely(_line <= 0)) {
-		assert(0 && "NULL pointer error");
-	}
+/**
+ *  __fastq_evt_ack - 读空门铃 eventfd（非阻塞）
+ */
+static void
+__fastq_evt_ack(struct FastQModule *pmodule)
+{
+	eventfd_t cnt;
 
-	int i;
+	eventfd_read(pmodule->notify_new_enqueue_evt_fd, &cnt);
+}
 
-	struct FastQModule *this_module = &_AllModulesRings[module_id];
+static int
+__fastq_evt_fd(struct FastQModule *pmodule)
+{
+	return pmodule->notify_new_enqueue_evt_fd;
+}
 
-	//检查模块是否已经注册 并 设置已注册标志
-	bool after_status = false;
-	if(!__atomic_compare_exchange_n(&this_module->already_register, &after_status,
-			true, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
-		fastq_log("\033[1;5;31mModule ID %ld already register in file <%s>'s "
-			"function <%s> at line %d\033[m\n", \
-			module_id,
-			this_module->_file,
-			this_module->_func,
-			this_module->_line);
+/**
+ *  select 后端，门铃 fd >= FD_SETSIZE 时注册模块改用 poll 后端，见 __fastq_backend_fit
+ */
+static int
+__fastq_select_wait(struct FastQModule *pmodule, int timeout_ms)
+{
+	struct timeval tv, *ptv = NULL;
+	int fd = pmodule->notify_new_enqueue_evt_fd;
+	fd_set readset;
 
-		assert(0 && "ERROR: Already register module.");
-		return ;
+	if (timeout_ms >= 0) {
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		ptv = &tv;
 	}
 
-	/**
-	 *  从这里开始, `this_module`的访问线程安全
-	 */
-	//已注册
-	__atomic_store_n(&this_module->status, MODULE_STATUS_REGISTED, __ATOMIC_RELEASE);
-	//在修改
-	__atomic_store_n(&this_module->status, MODULE_STATUS_MODIFY, __ATOMIC_RELEASE);
+	FD_ZERO(&readset);
+	FD_SET(fd, &readset);
 
-	//设置 发送 接收 set
-	if(rxset) {
-		pthread_rwlock_wrlock(&this_module->rx.rwlock);
-		memcpy(&this_module->rx.set, rxset, sizeof(mod_set));
-		pthread_rwlock_unlock(&this_module->rx.rwlock);
-	}
-	if(txset) {
-		pthread_rwlock_wrlock(&this_module->tx.rwlock);
-		memcpy(&this_module->tx.set, txset, sizeof(mod_set));
-		pthread_rwlock_unlock(&this_module->tx.rwlock);
-	}
+	return select(fd+1, &readset, NULL, NULL, ptv);
+}
 
-	this_module->notify_new_enqueue_evt_fd = eventfd(0, EFD_CLOEXEC);
-	assert(this_module->notify_new_enqueue_evt_fd && "Eventfd create error");
+/**
+ *  poll 后端
+ */
+static int
+__fastq_poll_wait(struct FastQModule *pmodule, int timeout_ms)
+{
+	struct pollfd pfd;
 
-#if defined(_FASTQ_EPOLL)
+	pfd.fd = pmodule->notify_new_enqueue_evt_fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
 
-	this_module->epfd = epoll_create(1);
-	assert(this_module->epfd && "Epoll create error");
+	return poll(&pfd, 1, timeout_ms);
+}
 
+/**
+ *  epoll 后端
+ */
+static void
+__fastq_epoll_init(struct FastQModule *pmodule)
+{
 	struct epoll_event event;
-	event.data.fd = this_module->notify_new_enqueue_evt_fd;
+
+	pmodule->epfd = epoll_create(1);
+	assert(pmodule->epfd >= 0 && "Epoll create error");
+
+	event.data.fd = pmodule->notify_new_enqueue_evt_fd;
 	event.events = EPOLLIN; //必须采用水平触发
-	epoll_ctl(this_module->epfd, EPOLL_CTL_ADD, event.data.fd, &event);
+	epoll_ctl(pmodule->epfd, EPOLL_CTL_ADD, event.data.fd, &event);
+}
+
+static void
+__fastq_epoll_fini(struct FastQModule *pmodule)
+{
+	close(pmodule->epfd);
+	pmodule->epfd = -1;
+}
+
+static int
+__fastq_epoll_wait(struct FastQModule *pmodule, int timeout_ms)
+{
+	struct epoll_event event;
+
+	return epoll_wait(pmodule->epfd, &event, 1, timeout_ms);
+}
 
-#elif defined(_FASTQ_SELECT)
+static int
+__fastq_epoll_fd(struct FastQModule *pmodule)
+{
+	return pmodule->epfd;
+}
 
-	pthread_rwlock_wrlock(&this_module->selector.rwlock);
-	FD_SET(this_module->notify_new_enqueue_evt_fd, &this_module->selector.readset);
-	if(this_module->notify_new_enqueue_evt_fd > this_module->selector.maxfd)
-	{
-		this_module->selector.maxfd = this_module->notify_new_enqueue_evt_fd;
+/**
+ *  io_uring 后端
+ *
+ *  io_uring 随模块槽位保留，删除模块时不释放，见 FastQUring
+ */
+static void
+__fastq_uring_init(struct FastQModule *pmodule)
+{
+	if (!pmodule->uring) {
+		pmodule->uring = __fastq_uring_create();
 	}
-	pthread_rwlock_unlock(&this_module->selector.rwlock);
+	/* 由接收线程提交，见 FastQUring */
+	pthread_mutex_lock(&pmodule->uring->lock);
+	__fastq_uring_poll(pmodule->uring, pmodule->notify_new_enqueue_evt_fd, true);
+	pthread_mutex_unlock(&pmodule->uring->lock);
+}
 
-#endif
+static void
+__fastq_uring_fini(struct FastQModule *pmodule)
+{
+	/* 接收线程可能正在 io_uring_enter 中等待，删除模块时已经唤醒，这里只移除 poll */
+	pthread_mutex_lock(&pmodule->uring->lock);
+	__fastq_uring_poll(pmodule->uring, pmodule->notify_new_enqueue_evt_fd, false);
+	pthread_mutex_unlock(&pmodule->uring->lock);
+}
 
-	//在哪里注册，用于调试
-	this_module->_file = FastQStrdup(_file);
-	this_module->_func = FastQStrdup(_func);
-	this_module->_line = _line;
+static int
+__fastq_uring_wait_evt(struct FastQModule *pmodule, int timeout_ms)
+{
+	return __fastq_uring_wait(pmodule->uring, timeout_ms);
+}
 
-	//队列大小
-	this_module->ring_size = __power_of_2(ring_size);
-	this_module->msg_size = msg_size;
+/**
+ *  __fastq_uring_ack - 收割门铃的 CQE 并读空门铃，io_uring 的 fd 不再可读
+ *
+ *  重新添加的 poll 立即提交，外部事件循环之后等待 FastQGetFd 时门铃仍在 poll 中
+ */
+static void
+__fastq_uring_ack(struct FastQModule *pmodule)
+{
+	pthread_mutex_lock(&pmodule->uring->lock);
+	__fastq_uring_reap(pmodule->uring);
+	__fastq_uring_submit(pmodule->uring);
+	pthread_mutex_unlock(&pmodule->uring->lock);
 
-	//当设置了标志位，并且对应的 ring 为空
-	if(MOD_ISSET(0, &this_module->rx.set) &&
-		!__atomic_load_n(&this_module->_ring[0], __ATOMIC_RELAXED)) {
-		/* 当源模块未初始化时又想向目的模块发送消息 */
-		__fastq_create_ring(this_module, 0, module_id);
-	}
-	/*建立住的模块和其他模块的连接关系
-		若注册前的连接关系如下：
-		下图为已经注册过两个模块 (模块 A 和 模块 B) 的数据结构
-						+---+
-						|   |
-						| A |
-						|   |
-					  / +---+
-					 /  /
-					/  /
-				   /  /
-				  /  /
-				 /  /
-			 +---+ /
-			 |   |
-			 | B |
-			 |   |
-			 +---+
+	__fastq_evt_ack(pmodule);
+}
 
-		在此基础上注册新的模块 (模块 C) 通过接下来的操作，将会创建四个 ring
+/**
+ *  __fastq_uring_fd - FastQGetFd: 先提交注册模块时写入的 poll，否则门铃响了 fd 也不可读
+ *
+ *  调用 FastQGetFd 的线程就是之后等待该 fd 并调用 FastQRecvOnce 的线程，见 FastQUring
+ */
+static int
+__fastq_uring_fd(struct FastQModule *pmodule)
+{
+	pthread_mutex_lock(&pmodule->uring->lock);
+	__fastq_uring_submit(pmodule->uring);
+	pthread_mutex_unlock(&pmodule->uring->lock);
 
-						+---+
+	return pmodule->uring->fd;
+}
+
+static const struct fastq_backend _fastq_backend_select = {
+	.type = FASTQ_BACKEND_SELECT,
+	.init = __fastq_nop_init,
+	.fini = __fastq_nop_init,
+	.wait = __fastq_select_wait,
+	.ack = __fastq_evt_ack,
+	.fd = __fastq_evt_fd,
+};
+
+static const struct fastq_backend _fastq_backend_poll = {
+	.type = FASTQ_BACKEND_POLL,
+	.init = __fastq_nop_init,
+	.fini = __fastq_nop_init,
+	.wait = __fastq_poll_wait,
+	.ack = __fastq_evt_ack,
+	.fd = __fastq_evt_fd,
+};
+
+static const struct fastq_backend _fastq_backend_epoll = {
+	.type = FASTQ_BACKEND_EPOLL,
+	.init = __fastq_epoll_init,
+	.fini = __fastq_epoll_fini,
+	.wait = __fastq_epoll_wait,
+	.ack = __fastq_evt_ack,
+	.fd = __fastq_epoll_fd,
+};
+
+static const struct fastq_backend _fastq_backend_futex = {
+	.type = FASTQ_BACKEND_FUTEX,
+	.init = __fastq_nop_init,
+	.fini = __fastq_nop_init,
+	.ack = __fastq_nop_init,
+	.fd = __fastq_nop_fd,
+};
+
+static const struct fastq_backend _fastq_backend_uring = {
+	.type = FASTQ_BACKEND_IO_URING,
+	.init = __fastq_uring_init,
+	.fini = __fastq_uring_fini,
+	.wait = __fastq_uring_wait_evt,
+	.ack = __fastq_uring_ack,
+	.fd = __fastq_uring_fd,
+};
+
+static const struct fastq_backend *const _fastq_backends[] = {
+	[FASTQ_BACKEND_SELECT]      = &_fastq_backend_select,
+	[FASTQ_BACKEND_POLL]        = &_fastq_backend_poll,
+	[FASTQ_BACKEND_EPOLL]       = &_fastq_backend_epoll,
+	[FASTQ_BACKEND_FUTEX]       = &_fastq_backend_futex,
+	[FASTQ_BACKEND_IO_URING]    = &_fastq_backend_uring,
+};
+
+/**
+ *  __fastq_backend_of - 注册模块时选择通知后端
+ */
+static const struct fastq_backend *
+__fastq_backend_of(const struct FastQModuleAttr *attr)
+{
+	unsigned int type = (attr && attr->backend) ? attr->backend : FASTQ_BACKEND_BUILTIN;
+
+	assert(type <= FASTQ_BACKEND_IO_URING && "Invalid backend.");
+
+	return _fastq_backends[type];
+}
+
+/**
+ *  __fastq_backend_fit - 门铃打开之后检查后端能否等待它
+ *
+ *  select() 只能等待小于 FD_SETSIZE 的 fd，进程打开很多文件时改用 poll 后端
+ */
+static const struct fastq_backend *
+__fastq_backend_fit(struct FastQModule *pmodule)
+{
+	int fd = pmodule->notify_new_enqueue_evt_fd;
+
+	if (unlikely(pmodule->backend == &_fastq_backend_select && fd >= FD_SETSIZE)) {
+		fastq_log("WARNING: select() can not wait fd %d (>= FD_SETSIZE), module %ld "
+			"falls back to FASTQ_BACKEND_POLL.\n", fd, pmodule->module_id);
+		return &_fastq_backend_poll;
+	}
+	return pmodule->backend;
+}
+
+static void  __fastq_log_init() {
+	char fasgq_log_file[256] = {"./.fastq.log"};    //这将是个隐藏文件
+	fastq_log_fp = fopen(fasgq_log_file, "w");
+	fastq_log_fp = fastq_log_fp?fastq_log_fp:stderr;
+}
+
+/**
+ *  FastQ 初始化 函数，初始化 _AllModulesRings 全局变量
+ */
+static void __attribute__((constructor(105))) __FastQInitCtor() {
+	int i, j;
+
+	__fastq_log_init();
+
+	/* 就绪位图 等按 cache line 对齐 */
+	_AllModulesRings = FastQMemalign(64, sizeof(struct FastQModule)*(FASTQ_ID_MAX+1));
+	assert(_AllModulesRings && "Malloc Failed: Out of Memory.");
+
+	for (i = 0; i <= FASTQ_ID_MAX; i++) {
+
+		struct FastQModule *this_module = &_AllModulesRings[i];
+
+		__atomic_store_n(&this_module->already_register, false, __ATOMIC_RELEASE);
+		__atomic_store_n(&this_module->status, MODULE_STATUS_INVALIDE, __ATOMIC_RELEASE);
+		__atomic_store_n(&this_module->name_attached, false, __ATOMIC_RELEASE);
+		this_module->name = NULL;
+
+		this_module->module_id = i;
+
+		//注册时重新选择
+		this_module->backend = _fastq_backends[FASTQ_BACKEND_BUILTIN];
+		this_module->epfd = -1;
+		this_module->uring = NULL;
+		this_module->notify_new_enqueue_evt_fd = -1;
+
+		//清空   rx 和 tx set
+		MOD_ZERO(&this_module->rx.set);
+		MOD_ZERO(&this_module->tx.set);
+		pthread_rwlock_init(&this_module->rx.rwlock, NULL);
+		pthread_rwlock_init(&this_module->tx.rwlock, NULL);
+
+		//清空 ring
+		this_module->flags = 0;
+		this_module->_prio_pending = 0;
+		this_module->ring_size = 0;
+		this_module->ring_max = 0;
+		this_module->msg_size = 0;
+		this_module->policy = FASTQ_FULL_BLOCK;
+		this_module->poll_us = 0;
+		this_module->_sleeping = 1;
+		this_module->_futex = 0;
+		this_module->_waiting = 0;
+		this_module->_poll_src = 0;
+		this_module->_ready_word = 0;
+		memset((void *)this_module->_ready, 0x00, sizeof(this_module->_ready));
+
+		//分配所有 ring 指针
+		struct FastQRing **___ring = FastQMalloc(sizeof(struct FastQRing*)*(FASTQ_ID_MAX+1));
+		assert(___ring && "Malloc Failed: Out of Memory.");
+
+		this_module->_ring = ___ring;
+		for (j = 0; j <= FASTQ_ID_MAX; j++) {
+			__atomic_store_n(&this_module->_ring[j], NULL, __ATOMIC_RELAXED);
+		}
+		this_module->_edge = NULL;
+		this_module->_bcast = NULL;
+
+		//活跃队列列表
+		this_module->_rx_list = NULL;
+		this_module->_tx_list = NULL;
+		this_module->_bcast_list = NULL;
+		this_module->_rcu.readers = 0;
+		this_module->_rcu.retired = NULL;
+		pthread_mutex_init(&this_module->_rcu.lock, NULL);
+	}
+
+	dict_init();
+}
+
+
+/******************************************************************************
+ *  原始接口
+ *****************************************************************************/
+/**
+ *  __fastq_ring_alloc - 分配并初始化环形队列
+ */
+static struct FastQRing *
+__fastq_ring_alloc(const unsigned long src, const unsigned long dst,
+	const unsigned long flags, const unsigned int ring_size,
+	const unsigned int msg_size) {
+
+	assert(!((flags & FASTQ_MODULE_F_MPSC) && (flags & FASTQ_MODULE_F_VARLEN))
+			&& "MPSC ring can not be variable-length.");
+	assert(!((flags & FASTQ_RING_F_OVERWRITE) &&
+			(flags & (FASTQ_MODULE_F_MPSC | FASTQ_MODULE_F_VARLEN)))
+			&& "Overwrite ring must be fixed-size SPSC.");
+
+	/* 消息大小 + 实际发送大小字段 + msgType + msgCode + msgSubCode, */
+	unsigned long ring_node_size = msg_size + FASTQ_NODE_HDR_SIZE;
+	unsigned long ring_real_size;
+
+	if (flags & FASTQ_MODULE_F_MPSC) {
+		/* 多入单出队列 节点头之前的发布序号 */
+		ring_node_size += FASTQ_MP_SEQ_SIZE;
+	}
+
+	if (flags & FASTQ_MODULE_F_VARLEN) {
+		/* 变长队列 按字节分配 */
+		ring_real_size = sizeof(struct FastQRing) + ring_size;
+	} else {
+		/* 定长队列 节点步长取 16/32/64 或 64 的整数倍，节点不跨 cache line */
+		ring_node_size = __fastq_node_stride(ring_node_size);
+		ring_real_size = sizeof(struct FastQRing) + ring_size*(ring_node_size);
+	}
+	if (flags & FASTQ_RING_F_OVERWRITE) {
+		/* 覆盖队列 消费者私有的拷贝节点 */
+		ring_real_size += ring_node_size;
+	}
+
+	struct FastQRing *new_ring = FastQMemalign(64, ring_real_size);
+	assert(new_ring && "Allocate FastQRing Failed. (OOM error)");
+
+	memset(new_ring, 0x00, ring_real_size);
+
+	new_ring->src = src;
+	new_ring->dst = dst;
+	new_ring->_flags = flags;
+	new_ring->_size = ring_size - 1;
+
+	new_ring->_msg_size = ring_node_size;
+
+	/* 新队列为空，第一条消息需要通知接收方 */
+	new_ring->_armed = 1;
+
+	return new_ring;
+}
+
+static void
+__fastq_create_ring(struct FastQModule *pmodule, const unsigned long src,
+	const unsigned long dst) {
+
+	const unsigned int ring_size = __fastq_edge_ring_size(pmodule, src);
+	const unsigned int msg_size = __fastq_edge_msg_size(pmodule, src);
+
+	fastq_log("Create ring : src(%lu)->dst(%lu) ringsize(%d) msgsize(%d).\n",
+		src, dst, ring_size, msg_size);
+
+	const unsigned int policy = __fastq_edge_policy(pmodule, src);
+
+	if (policy != __fastq_edge_policy_set(pmodule, src)) {
+		fastq_log("WARNING: multi-producer ring src(%lu)->dst(%lu) can not be overwritten, "
+			"use FASTQ_FULL_DROP_NEWEST.\n", src, dst);
+	}
+
+	/* 源模块的多个线程可能同时发送 */
+	unsigned long flags = pmodule->flags |
+			(_AllModulesRings[src].flags & FASTQ_MODULE_F_MPSC) |
+			(policy == FASTQ_FULL_OVERWRITE ? FASTQ_RING_F_OVERWRITE : 0);
+
+	if (!__fastq_edge_varlen(pmodule, src)) {
+		flags &= ~FASTQ_MODULE_F_VARLEN;
+	}
+
+	struct FastQRing *new_ring = __fastq_ring_alloc(src, dst, flags, ring_size, msg_size);
+	new_ring->_policy = policy;
+
+	struct fastq_ring_rx *rx = FastQMalloc(sizeof(struct fastq_ring_rx));
+	assert(rx && "Malloc Failed: Out of Memory.");
+
+	rx->ring = new_ring;
+	new_ring->_rx = rx;
+
+	/* 不需要通知接收方：新队列的 _armed 为 1，第一条消息会置就绪位 */
+	__atomic_store_n(&pmodule->_ring[src], new_ring, __ATOMIC_RELEASE);
+
+	__fastq_list_add(&pmodule->_rcu, &pmodule->_rx_list, src);
+	__fastq_list_add(&_AllModulesRings[src]._rcu, &_AllModulesRings[src]._tx_list, dst);
+}
+
+
+static void
+__fastq_destroy_ring(struct FastQModule *pmodule, const unsigned long src,
+	const unsigned long dst) {
+
+	struct FastQRing *this_ring = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_RELAXED);
+	struct fastq_ring_rx *rx = this_ring->_rx;
+	struct FastQRing *oldest = __atomic_load_n(&rx->ring, __ATOMIC_RELAXED);
+
+	fastq_log("Destroy ring : src(%lu)->dst(%lu) ringsize(%d) msgsize(%d).\n",
+					src, dst, this_ring->_size + 1, __fastq_edge_msg_size(pmodule, src));
+
+	__atomic_store_n(&pmodule->_ring[src], NULL, __ATOMIC_RELEASE);
+
+	__fastq_list_del(&pmodule->_rcu, &pmodule->_rx_list, src);
+	__fastq_list_del(&_AllModulesRings[src]._rcu, &_AllModulesRings[src]._tx_list, dst);
+
+	/**
+	 *  统计、FastQDump 和 接收线程 只持有 _rcu 读者计数访问队列，
+	 *  等它们退出后再释放
+	 */
+	if (this_ring->_prio) {
+		__fastq_call_rcu(&pmodule->_rcu, &this_ring->_prio->rcu, __fastq_ring_release);
+	}
+
+	/* 扩容后消费者还没有切换过去的旧队列 */
+	while (oldest != this_ring) {
+		struct FastQRing *next = oldest->_next;
+		__fastq_call_rcu(&pmodule->_rcu, &oldest->rcu, __fastq_ring_release);
+		oldest = next;
+	}
+	__fastq_call_rcu(&pmodule->_rcu, &this_ring->rcu, __fastq_ring_release);
+	__fastq_call_rcu(&pmodule->_rcu, &rx->rcu, __fastq_ring_release);
+}
+
+/**
+ *  __fastq_bcast_create - 创建源模块的广播队列，大小与该模块注册时的参数一致
+ */
+static struct FastQBcastRing *
+__fastq_bcast_create(struct FastQModule *pmodule)
+{
+	unsigned int ring_size = pmodule->ring_size;
+	const unsigned int msg_size = pmodule->msg_size;
+
+	if (pmodule->flags & FASTQ_MODULE_F_VARLEN) {
+		/* 变长队列 的 ring_size 是字节数 */
+		ring_size = __power_of_2(ring_size / __fastq_varlen_len(msg_size));
+	}
+
+	fastq_log("Create broadcast ring : src(%lu) ringsize(%d) msgsize(%d).\n",
+		pmodule->module_id, ring_size, msg_size);
+
+	unsigned long ring_node_size = __fastq_node_stride(FASTQ_BCAST_SLOT_SIZE
+						+ FASTQ_NODE_HDR_SIZE + msg_size);
+	unsigned long ring_real_size = sizeof(struct FastQBcastRing) + ring_size*ring_node_size;
+
+	struct FastQBcastRing *bcast = FastQMemalign(64, ring_real_size);
+	assert(bcast && "Allocate FastQBcastRing Failed. (OOM error)");
+
+	memset(bcast, 0x00, ring_real_size);
+
+	bcast->src = pmodule->module_id;
+	bcast->_size = ring_size - 1;
+	bcast->_msg_size = ring_node_size;
+	bcast->_refs = 1;
+	pthread_mutex_init(&bcast->_lock, NULL);
+
+	return bcast;
+}
+
+/**
+ *  __fastq_bcast_put - 释放一个广播队列的引用，最后一个引用释放广播队列
+ */
+static void
+__fastq_bcast_put(struct FastQBcastRing *bcast)
+{
+	if (!__atomic_sub_fetch(&bcast->_refs, 1, __ATOMIC_ACQ_REL)) {
+		fastq_log("Free broadcast ring : src(%lu).\n", bcast->src);
+		pthread_mutex_destroy(&bcast->_lock);
+		FastQFree(bcast);
+	}
+}
+
+static void
+__fastq_bcast_release(struct fastq_rcu_head *head)
+{
+	__fastq_bcast_put((struct FastQBcastRing *)head);
+}
+
+static void
+__fastq_bcast_reader_free(struct fastq_rcu_head *head)
+{
+	struct FastQBcastReader *reader = (struct FastQBcastReader *)head;
+
+	__fastq_bcast_put(reader->bcast);
+	FastQFree(reader);
+}
+
+/**
+ *  __fastq_bcast_reader_retire - 源模块的读者（生产者）已经退出，再等接收模块的读者退出
+ */
+static void
+__fastq_bcast_reader_retire(struct fastq_rcu_head *head)
+{
+	struct FastQBcastReader *reader = (struct FastQBcastReader *)head;
+
+	__fastq_call_rcu(&_AllModulesRings[reader->dst]._rcu, head, __fastq_bcast_reader_free);
+}
+
+/**
+ *  __fastq_bcast_add_reader - 为接收模块 dst 创建广播队列的读者，从当前位置开始读
+ *
+ *  由生产者调用，与删除读者互斥；dst 已经开始删除时不再创建
+ *
+ *  return 读者下标+1，dst 未注册返回 0
+ */
+static unsigned int
+__fastq_bcast_add_reader(struct FastQBcastRing *bcast, const unsigned long dst)
+{
+	struct FastQModule *pmodule = &_AllModulesRings[dst];
+	struct FastQBcastReader *reader;
+	unsigned int idx;
+
+	assert(!(pmodule->flags & FASTQ_MODULE_F_MULTI_CONSUMER)
+			&& "Broadcast to multi-consumer module is not supported.");
+
+	pthread_mutex_lock(&bcast->_lock);
+
+	/* FastQDeleteModule 先清除注册标志再删除读者 */
+	if ((idx = bcast->_reader_of[dst]) ||
+		!__atomic_load_n(&pmodule->already_register, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_unlock(&bcast->_lock);
+		return idx;
+	}
+
+	for (idx = 0; idx < FASTQ_BCAST_READER_MAX; idx++) {
+		if (!bcast->_readers[idx]) {
+			break;
+		}
+	}
+	assert(idx < FASTQ_BCAST_READER_MAX && "Too many broadcast readers.");
+
+	fastq_log("Create broadcast reader : src(%lu)->dst(%lu) idx(%d).\n",
+		bcast->src, dst, idx);
+
+	reader = FastQMemalign(64, sizeof(struct FastQBcastReader));
+	assert(reader && "Allocate FastQBcastReader Failed. (OOM error)");
+
+	memset(reader, 0x00, sizeof(struct FastQBcastReader));
+
+	reader->bcast = bcast;
+	reader->src = bcast->src;
+	reader->dst = dst;
+	reader->idx = idx;
+	reader->_cursor = bcast->_tail;
+	reader->_armed = 1;
+	__atomic_add_fetch(&bcast->_refs, 1, __ATOMIC_RELAXED);
+
+	/* 接收模块先能找到读者，生产者才会向它发消息 */
+	__fastq_list_add(&pmodule->_rcu, &pmodule->_bcast_list, (unsigned long)reader);
+
+	bcast->_cursor_cache[idx] = bcast->_tail;
+	__atomic_store_n(&bcast->_readers[idx], reader, __ATOMIC_RELEASE);
+	__atomic_store_n(&bcast->_reader_of[dst], idx + 1, __ATOMIC_RELEASE);
+	__atomic_or_fetch(&bcast->_live, 1UL << idx, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&bcast->_lock);
+
+	return idx + 1;
+}
+
+/**
+ *  __fastq_bcast_unlink - 让生产者看不到下标 idx 的读者，调用者持有 bcast->_lock
+ */
+static struct FastQBcastReader *
+__fastq_bcast_unlink(struct FastQBcastRing *bcast, unsigned int idx)
+{
+	struct FastQBcastReader *reader = bcast->_readers[idx];
+
+	fastq_log("Destroy broadcast reader : src(%lu)->dst(%lu) idx(%d).\n",
+		bcast->src, reader->dst, idx);
+
+	/* 生产者不再等待该读者 */
+	__atomic_and_fetch(&bcast->_live, ~(1UL << idx), __ATOMIC_RELEASE);
+
+	__atomic_store_n(&bcast->_readers[idx], NULL, __ATOMIC_RELEASE);
+	__atomic_store_n(&bcast->_reader_of[reader->dst], 0, __ATOMIC_RELEASE);
+
+	return reader;
+}
+
+/**
+ *  __fastq_bcast_retire - 让接收模块看不到读者，生产者和接收模块的读者都退出后释放
+ */
+static void
+__fastq_bcast_retire(struct FastQBcastReader *reader)
+{
+	struct FastQModule *pmodule = &_AllModulesRings[reader->dst];
+
+	__fastq_list_del(&pmodule->_rcu, &pmodule->_bcast_list, (unsigned long)reader);
+
+	__fastq_call_rcu(&_AllModulesRings[reader->src]._rcu, &reader->rcu,
+			__fastq_bcast_reader_retire);
+}
+
+/**
+ *  __fastq_bcast_del_reader - 删除接收模块 dst 的读者
+ */
+static void
+__fastq_bcast_del_reader(struct FastQBcastRing *bcast, const unsigned long dst)
+{
+	struct FastQBcastReader *reader = NULL;
+	unsigned int idx;
+
+	pthread_mutex_lock(&bcast->_lock);
+	if ((idx = bcast->_reader_of[dst])) {
+		reader = __fastq_bcast_unlink(bcast, idx - 1);
+	}
+	pthread_mutex_unlock(&bcast->_lock);
+
+	if (reader) {
+		__fastq_bcast_retire(reader);
+	}
+}
+
+/**
+ *  __fastq_bcast_destroy - 删除源模块的广播队列和所有读者
+ *
+ *  源模块的读者（生产者）退出后释放源模块持有的引用，读者都释放后才释放广播队列
+ */
+static void
+__fastq_bcast_destroy(struct FastQModule *pmodule)
+{
+	struct FastQBcastRing *bcast = __atomic_exchange_n(&pmodule->_bcast, NULL, __ATOMIC_ACQ_REL);
+	struct FastQBcastReader *readers[FASTQ_BCAST_READER_MAX];
+	unsigned int idx, n = 0;
+
+	if (!bcast) {
+		return;
+	}
+
+	pthread_mutex_lock(&bcast->_lock);
+	for (idx = 0; idx < FASTQ_BCAST_READER_MAX; idx++) {
+		if (bcast->_readers[idx]) {
+			readers[n++] = __fastq_bcast_unlink(bcast, idx);
+		}
+	}
+	pthread_mutex_unlock(&bcast->_lock);
+
+	while (n) {
+		__fastq_bcast_retire(readers[--n]);
+	}
+
+	fastq_log("Destroy broadcast ring : src(%lu).\n", bcast->src);
+
+	__fastq_call_rcu(&pmodule->_rcu, &bcast->rcu, __fastq_bcast_release);
+}
+
+
+void
+FastQCreateModuleDump(const unsigned long module_id,
+						const mod_set *rxset, const mod_set *txset,
+						const unsigned int ring_size, const unsigned int msg_size,
+						const char *_file, const char *_func, const int _line)
+{
+	FastQCreateModuleAttrDump(module_id, rxset, txset, ring_size, msg_size,
+						NULL, _file, _func, _line);
+}
+
+void
+FastQCreateModuleAttrDump(const unsigned long module_id,
+						const mod_set *rxset, const mod_set *txset,
+						const unsigned int ring_size, const unsigned int msg_size,
+						const struct FastQModuleAttr *attr,
+						const char *_file, const char *_func, const int _line)
+{
+	assert(module_id <= FASTQ_ID_MAX && "Module ID out of range");
+
+	if(unlikely(!_file) || unlikely(!_func) || unlikely(_line <= 0)) {
+		assert(0 && "NULL pointer error");
+	}
+
+	struct fastq_id_list *modules;
+	unsigned int k;
+	int i;
+
+	struct FastQModule *this_module = &_AllModulesRings[module_id];
+
+	//检查模块是否已经注册 并 设置已注册标志
+	bool after_status = false;
+	if(!__atomic_compare_exchange_n(&this_module->already_register, &after_status,
+			true, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		fastq_log("\033[1;5;31mModule ID %ld already register in file <%s>'s "
+			"function <%s> at line %d\033[m\n", \
+			module_id,
+			this_module->_file,
+			this_module->_func,
+			this_module->_line);
+
+		assert(0 && "ERROR: Already register module.");
+		return ;
+	}
+
+	/**
+	 *  从这里开始, `this_module`的访问线程安全
+	 */
+	//已注册
+	__atomic_store_n(&this_module->status, MODULE_STATUS_REGISTED, __ATOMIC_RELEASE);
+	//在修改
+	__atomic_store_n(&this_module->status, MODULE_STATUS_MODIFY, __ATOMIC_RELEASE);
+
+	//设置 发送 接收 set
+	if(rxset) {
+		pthread_rwlock_wrlock(&this_module->rx.rwlock);
+		memcpy(&this_module->rx.set, rxset, sizeof(mod_set));
+		pthread_rwlock_unlock(&this_module->rx.rwlock);
+	}
+	if(txset) {
+		pthread_rwlock_wrlock(&this_module->tx.rwlock);
+		memcpy(&this_module->tx.set, txset, sizeof(mod_set));
+		pthread_rwlock_unlock(&this_module->tx.rwlock);
+	}
+
+	/* 通知后端 */
+	this_module->backend = __fastq_backend_of(attr);
+
+	/* 门铃 和 就绪位图 */
+	this_module->notify_new_enqueue_evt_fd = __fastq_evt_open(this_module);
+	this_module->backend = __fastq_backend_fit(this_module);
+	this_module->backend->init(this_module);
+	memset((void *)this_module->_ready, 0x00, sizeof(this_module->_ready));
+	this_module->_ready_word = 0;
+
+	//在哪里注册，用于调试
+	this_module->_file = FastQStrdup(_file);
+	this_module->_func = FastQStrdup(_func);
+	this_module->_line = _line;
+
+	//队列大小
+	this_module->flags = attr ? attr->flags : 0;
+	if (this_module->flags & FASTQ_MODULE_F_POLL_ONLY) {
+		this_module->flags |= FASTQ_MODULE_F_BUSY_POLL;
+	}
+	this_module->ring_size = __power_of_2(ring_size);
+	this_module->msg_size = msg_size;
+	this_module->policy = attr ? attr->policy : FASTQ_FULL_BLOCK;
+
+	assert(this_module->policy <= FASTQ_FULL_DROP_PRIO && "Invalid full-queue policy.");
+	assert(!(this_module->policy == FASTQ_FULL_OVERWRITE &&
+			(this_module->flags & FASTQ_MODULE_F_VARLEN))
+			&& "Variable-length ring can not be overwritten.");
+	assert(!(this_module->policy == FASTQ_FULL_OVERWRITE &&
+			(this_module->flags & FASTQ_MODULE_F_MPSC))
+			&& "Multi-producer ring can not be overwritten.");
+	assert(!((this_module->flags & FASTQ_MODULE_F_BUSY_POLL) &&
+			(this_module->flags & FASTQ_MODULE_F_MULTI_CONSUMER))
+			&& "Busy-poll module can not have multiple consumers.");
+
+	/* 忙轮询 空转时间，接收线程开始轮询之前 生产者都要敲门铃 */
+	this_module->poll_us = (attr && attr->poll_us) ? attr->poll_us : FASTQ_POLL_US_DEFAULT;
+	this_module->_sleeping = 1;
+	this_module->_poll_src = 0;
+
+	/* 自动扩容的上限 */
+	this_module->ring_max = __power_of_2((attr && attr->ring_max) ?
+				attr->ring_max : ring_size * FASTQ_AUTO_GROW_DEFAULT);
+	if (this_module->ring_max < this_module->ring_size) {
+		this_module->ring_max = this_module->ring_size;
+	}
+
+	if (this_module->flags & FASTQ_MODULE_F_VARLEN) {
+		unsigned int max_record = __fastq_varlen_len(msg_size);
+		unsigned int ring_bytes = (attr && attr->ring_bytes) ?
+				attr->ring_bytes : ring_size * max_record;
+
+		this_module->ring_size = __fastq_varlen_bytes(ring_bytes, msg_size);
+		this_module->ring_max = __fastq_varlen_bytes(
+				this_module->ring_max * max_record, msg_size);
+		if (this_module->ring_max < this_module->ring_size) {
+			this_module->ring_max = this_module->ring_size;
+		}
+	}
+
+	//当设置了标志位，并且对应的 ring 为空
+	if(MOD_ISSET(0, &this_module->rx.set) &&
+		!__atomic_load_n(&this_module->_ring[0], __ATOMIC_RELAXED)) {
+		/* 当源模块未初始化时又想向目的模块发送消息 */
+		__fastq_create_ring(this_module, 0, module_id);
+	}
+	/*建立住的模块和其他模块的连接关系
+		若注册前的连接关系如下：
+		下图为已经注册过两个模块 (模块 A 和 模块 B) 的数据结构
+						+---+
+						|   |
+						| A |
+						|   |
+					  / +---+
+					 /  /
+					/  /
+				   /  /
+				  /  /
+				 /  /
+			 +---+ /
+			 |   |
+			 | B |
+			 |   |
+			 +---+
+
+		在此基础上注册新的模块 (模块 C) 通过接下来的操作，将会创建四个 ring
+
+						+---+
 						|   |
 						| A |
 						|   |
@@ -608,577 +2141,3295 @@ FastQCreateModuleDump(const unsigned long module_id,
 			 |   | --------------> |   |
 			 +---+                 +---+
 
-		值得注意的是，在创建 ring 时，会根据入参中的 rxset 和 txset 决定分配哪些 ring 和 eventfd
-		以上面的 ABC 模块为例，具体如下：
+		值得注意的是，在创建 ring 时，会根据入参中的 rxset 和 txset 决定分配哪些 ring
+		以上面的 ABC 模块为例，具体如下：
+
+		注册过程：假设模块ID分别为 A=1, B=2, C=3
+
+					rxset       txset           表明
+				A(1)    1100        0000    A可能从B(2)C(3)接收，不接收任何数据
+				B(2)    0000        0010    B不接受任何数据，可能向A(1)发送
+				C(3)    0000        0010    C不接受任何数据，可能向A(1)发送
+		 那么创建的 底层数据结构将会是
+
+						+---+
+						|   |
+						| A |
+						|   |
+					  /`+---+ \`
+					 /         \
+					/           \
+				   /             \
+				  /               \
+				 /                 \
+			 +---+                 +---+
+			 |   |                 |   |
+			 | B |                 | C |
+			 |   |                 |   |
+			 +---+                 +---+
+	*/
+	__fastq_list_add(&_AllModulesListRcu, &_AllModulesList, module_id);
+
+	/* 只遍历已注册的模块 */
+	modules = __fastq_rcu_read_lock(&_AllModulesListRcu, &_AllModulesList);
+
+	for (k = 0; modules && k < modules->nr; k++) {
+		i = modules->id[k];
+
+		/**
+		 *  若模块自己给自己发送，创建环形队列将不在这里创建，而是在发送第一条消息时创建
+		 *  2021年5月11日 荣涛
+		 */
+		if(i == module_id) continue;
+
+		struct FastQModule *peer_module = &_AllModulesRings[i];
+
+		if(!__atomic_load_n(&peer_module->already_register, __ATOMIC_RELAXED)) {
+				continue;
+		}
+
+		//任意一个模块标记了可能发送或者接收的模块，都将创建队列
+		if (MOD_ISSET(i, &this_module->rx.set) ||
+		   MOD_ISSET(module_id, &peer_module->tx.set)) {
+
+				MOD_SET(i, &this_module->rx.set);
+				MOD_SET(module_id, &peer_module->tx.set);
+
+				__fastq_create_ring(this_module, i, module_id);
+		}
+		if (!__atomic_load_n(&peer_module->_ring[module_id], __ATOMIC_RELAXED)) {
+
+				if(MOD_ISSET(i, &this_module->tx.set) ||
+				   MOD_ISSET(module_id, &peer_module->rx.set)) {
+
+				MOD_SET(i, &this_module->tx.set);
+				MOD_SET(module_id, &peer_module->rx.set);
+
+				__fastq_create_ring(peer_module, module_id, i);
+				}
+		}
+	}
+	__fastq_rcu_read_unlock(&_AllModulesListRcu);
+
+	//已注册
+	__atomic_store_n(&this_module->status, MODULE_STATUS_REGISTED, __ATOMIC_RELEASE);
+
+	return;
+}
+
+bool
+FastQAddSet(const unsigned long moduleID, const mod_set *rxset,
+	const mod_set *txset)
+{
+	if (unlikely(!rxset && !txset)) {
+		return false;
+	}
+	if (moduleID <= 0 || moduleID > FASTQ_ID_MAX) {
+		return false;
+	}
+	struct FastQModule *this_module = &_AllModulesRings[moduleID];
+
+	if (!__atomic_load_n(&this_module->already_register, __ATOMIC_RELAXED)) {
+
+		return false;
+	}
+
+	//自旋获取修改权限
+	module_status_t should_be = MODULE_STATUS_OK;
+	while (!__atomic_compare_exchange_n(&this_module->status, &should_be,
+				MODULE_STATUS_MODIFY, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		__relax();
+		should_be = MODULE_STATUS_OK;
+	}
+
+	/**
+	 *  从这里开始, 将会修改 模块内容，模块状态为 `MODULE_STATUS_MODIFY`
+	 */
+	struct fastq_id_list *modules;
+	unsigned int k;
+	int i;
+
+	//遍历已注册的模块
+	modules = __fastq_rcu_read_lock(&_AllModulesListRcu, &_AllModulesList);
+
+	for (k = 0; modules && k < modules->nr; k++) {
+		i = modules->id[k];
+		if (i == moduleID) continue;
+
+		struct FastQModule *peer_module = &_AllModulesRings[i];
+
+		//目的模块必须存在
+		if (!__atomic_load_n(&peer_module->already_register, __ATOMIC_RELAXED)) {
+				continue;
+		}
+
+		//接收
+		pthread_rwlock_wrlock(&this_module->rx.rwlock);
+		if (rxset && MOD_ISSET(i, rxset) && !MOD_ISSET(i, &this_module->rx.set)) {
+				MOD_SET(i, &this_module->rx.set);
+				pthread_rwlock_wrlock(&peer_module->tx.rwlock);
+				MOD_SET(moduleID, &peer_module->tx.set);
+				pthread_rwlock_unlock(&peer_module->tx.rwlock);
+
+				__fastq_create_ring(this_module, i, moduleID);
+		}
+		pthread_rwlock_unlock(&this_module->rx.rwlock);
+
+		//发送
+		pthread_rwlock_wrlock(&this_module->tx.rwlock);
+		if (txset && MOD_ISSET(i, txset) && !MOD_ISSET(i, &this_module->tx.set)) {
+				MOD_SET(i, &this_module->tx.set);
+				pthread_rwlock_wrlock(&peer_module->rx.rwlock);
+				MOD_SET(moduleID, &peer_module->rx.set);
+				pthread_rwlock_unlock(&peer_module->rx.rwlock);
+
+				__fastq_create_ring( peer_module, moduleID, i);
+		}
+		pthread_rwlock_unlock(&this_module->tx.rwlock);
+	}
+	__fastq_rcu_read_unlock(&_AllModulesListRcu);
+
+	__atomic_store_n(&this_module->status, MODULE_STATUS_OK, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+bool
+FastQDeleteModule(const unsigned long moduleID)
+{
+	struct fastq_id_list *list;
+	unsigned int k;
+	int i;
+
+	if ((moduleID <= 0 || moduleID > FASTQ_ID_MAX) ) {
+		return false;
+	}
+
+	struct FastQModule *this_module = &_AllModulesRings[moduleID];
+
+	pthread_rwlock_wrlock(&_AllModulesRingsLock);
+
+	//检查模块是否已经注册
+	if(!__atomic_load_n(&this_module->already_register, __ATOMIC_RELAXED)) {
+		pthread_rwlock_unlock(&_AllModulesRingsLock);
+		return true; //不存在也是删除成功吧
+	}
+
+	/**
+	 *  只遍历活跃队列列表；删除队列会替换列表，持有读者计数时旧列表不会被释放
+	 */
+
+	//接收，包括 源模块 0 和 自己发给自己的队列
+	list = __fastq_rcu_read_lock(&this_module->_rcu, &this_module->_rx_list);
+	for (k = 0; list && k < list->nr; k++) {
+		i = list->id[k];
+
+		pthread_rwlock_wrlock(&this_module->rx.rwlock);
+		MOD_CLR(i, &this_module->rx.set);
+		if (__atomic_load_n(&this_module->_ring[i], __ATOMIC_RELAXED)) {
+				__fastq_destroy_ring(this_module, i, moduleID);
+		}
+		pthread_rwlock_unlock(&this_module->rx.rwlock);
+	}
+	__fastq_rcu_read_unlock(&this_module->_rcu);
+
+	//发送
+	list = __fastq_rcu_read_lock(&this_module->_rcu, &this_module->_tx_list);
+	for (k = 0; list && k < list->nr; k++) {
+		i = list->id[k];
+
+		struct FastQModule *peer_module = &_AllModulesRings[i];
+
+		pthread_rwlock_wrlock(&this_module->tx.rwlock);
+		MOD_CLR(i, &this_module->tx.set);
+		if (__atomic_load_n(&peer_module->_ring[moduleID], __ATOMIC_RELAXED)) {
+				__fastq_destroy_ring( peer_module, moduleID, i);
+		}
+		pthread_rwlock_unlock(&this_module->tx.rwlock);
+	}
+	__fastq_rcu_read_unlock(&this_module->_rcu);
+
+	FastQFree(this_module->_file);
+	FastQFree(this_module->_func);
+
+	if (this_module->_edge) {
+		FastQFree(this_module->_edge);
+		__atomic_store_n(&this_module->_edge, NULL, __ATOMIC_RELEASE);
+	}
+
+	memset(&this_module->tx.set, 0x00, sizeof(mod_set));
+	memset(&this_module->rx.set, 0x00, sizeof(mod_set));
+
+	if (__atomic_load_n(&this_module->name_attached, __ATOMIC_RELAXED)) {
+		dict_unregister_module(this_module->name);
+		FastQFree(this_module->name);
+		__atomic_store_n(&this_module->name_attached, false, __ATOMIC_RELEASE);
+	}
+
+	__atomic_store_n(&this_module->already_register, false, __ATOMIC_RELEASE);
+	__fastq_list_del(&_AllModulesListRcu, &_AllModulesList, moduleID);
+
+	/**
+	 *  清除注册标志之后再删除广播读者，生产者不会再为该模块创建读者；
+	 *  持有读者计数时列表中的读者不会被释放，读者持有广播队列的引用
+	 */
+
+	//广播接收
+	list = __fastq_rcu_read_lock(&this_module->_rcu, &this_module->_bcast_list);
+	for (k = 0; list && k < list->nr; k++) {
+		struct FastQBcastReader *reader = (struct FastQBcastReader *)list->id[k];
+
+		__fastq_bcast_del_reader(reader->bcast, moduleID);
+	}
+	__fastq_rcu_read_unlock(&this_module->_rcu);
+
+	//广播发送
+	__fastq_bcast_destroy(this_module);
+
+	/**
+	 *  接收线程可能正在等待，唤醒后发现模块已被删除，退出；
+	 *  关闭 fd 会把门铃从 epoll 集合中摘掉，被唤醒还没取走事件的 epoll_wait 会重新睡眠，
+	 *  所以等所有接收线程离开 backend->wait 再关闭，多消费者模式 门铃可能被其中一个读空，每轮重敲
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	do {
+		__fastq_module_kick(this_module);
+		if (!__atomic_load_n(&this_module->_waiting, __ATOMIC_SEQ_CST)) {
+			break;
+		}
+		sched_yield();
+	} while (1);
+
+	this_module->backend->fini(this_module);
+	__fastq_evt_close(this_module->notify_new_enqueue_evt_fd);
+	this_module->notify_new_enqueue_evt_fd = -1;
+
+	pthread_rwlock_unlock(&_AllModulesRingsLock);
+
+	return true;
+}
+
+bool
+FastQAttachName(const unsigned long moduleID, const char *name)
+{
+	if (unlikely(moduleID <= 0 || moduleID > FASTQ_ID_MAX) ) {
+		assert(0 && "Invalid moduleID.");
+		return false;
+	}
+	if (unlikely(!name)) {
+		assert(0 && "Invalid MODULE name.");
+		return false;
+	}
+	struct FastQModule *this_module = &_AllModulesRings[moduleID];
+
+	//检查模块是否已经注册
+	if (!__atomic_load_n(&this_module->already_register, __ATOMIC_RELAXED)) {
+		fastq_log("ERROR: MODULE not registed error(id = %ld).\n", moduleID);
+		return false;
+	}
+
+	if (__atomic_load_n(&this_module->name_attached, __ATOMIC_RELAXED)) {
+		fastq_log("ERROR: MODULE name already attached error(id = %ld).\n", moduleID);
+		return false;
+	}
+
+	mrbarrier();
+	//保存名字并添加至 字典
+	this_module->name = FastQStrdup(name);
+	mwbarrier();
+
+	dict_register_module(this_module->name, moduleID);
+
+	__atomic_store_n(&this_module->name_attached, true, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ *  __FastQSend - 公共发送函数
+ */
+/**
+ *  __fastq_ring_free - 生产者: 从 t 开始的空闲节点数
+ *
+ *  缓存的 _head 不足 want 个空闲节点时，才读取消费者的 _head
+ */
+static inline unsigned int
+__fastq_ring_free(struct FastQRing *ring, unsigned int t, unsigned int want)
+{
+	unsigned int free = (ring->_head_cache - t - 1) & ring->_size;
+
+	if (free < want) {
+		ring->_head_cache = __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE);
+		free = (ring->_head_cache - t - 1) & ring->_size;
+	}
+	return free;
+}
+
+/**
+ *  __fastq_ring_count - 消费者: 从 h 开始的可读节点数
+ *
+ *  缓存的 _tail 不足 want 个可读节点时，才读取生产者的 _tail；
+ *  覆盖队列 的 _head 可能被生产者推过缓存的 _tail，此时缓存算出的节点数是错的，每次都重新读取
+ */
+static inline unsigned int
+__fastq_ring_count(struct FastQRing *ring, unsigned int h, unsigned int want)
+{
+	unsigned int count = (ring->_tail_cache - h) & ring->_size;
+
+	if (count < want || __fastq_is_ow(ring)) {
+		ring->_tail_cache = __atomic_load_n(&ring->_tail, __ATOMIC_ACQUIRE);
+		count = (ring->_tail_cache - h) & ring->_size;
+	}
+	return count;
+}
+
+/**
+ *  __fastq_mp_claim - 多入单出队列 生产者: CAS 移动 _tail，一次申请最多 num 个节点
+ *
+ *  _head_cache 由多个生产者共享，只是一个不超过 _head 的提示，
+ *  可能比本线程读到的 _tail 还新，此时重新读取 _tail
+ *
+ *  return 申请到的节点数，*pos 为第一个节点的位置； 队列满时返回 0
+ */
+static inline unsigned int
+__fastq_mp_claim(struct FastQRing *ring, unsigned int *pos, unsigned int num)
+{
+	const unsigned int cap = ring->_size + 1;
+	unsigned int t = __atomic_load_n(&ring->_tail, __ATOMIC_RELAXED);
+	unsigned int h, n;
+
+	for (;;) {
+		h = __atomic_load_n(&ring->_head_cache, __ATOMIC_ACQUIRE);
+		if (t - h >= cap) {
+			h = __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE);
+			__atomic_store_n(&ring->_head_cache, h, __ATOMIC_RELEASE);
+			if (t - h > cap) {
+				t = __atomic_load_n(&ring->_tail, __ATOMIC_RELAXED);
+				continue;
+			}
+			if (t - h == cap) {
+				return 0;
+			}
+		}
+		n = min(num, cap - (t - h));
+		if (__atomic_compare_exchange_n(&ring->_tail, &t, t + n, 1,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+
+	*pos = t;
+	return n;
+}
+
+/**
+ *  __fastq_mp_publish - 多入单出队列 生产者: 发布位置 pos 处已写好的节点
+ */
+static inline void
+__fastq_mp_publish(char *d, unsigned int pos)
+{
+	__atomic_store_n(&__fastq_mp_seq(d), pos + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ *  __fastq_backoff - 生产者: 等待一次 *word 变化，自旋 -> sched_yield -> futex 等待
+ *
+ *  param[in]       word        对端推进的位置，队列的 _head 或 广播读者的 _cursor
+ *  param[in]       waiting     等待标志，对端推进 word 之后看到 1 时唤醒，见 __fastq_futex_wake
+ *  param[inout]    spins       本次发送已经等待的次数，从 0 开始
+ *  param[in]       deadline    CLOCK_MONOTONIC 超时时间，NULL 表示一直等待
+ *
+ *  return 超时返回 false
+ */
+static bool
+__fastq_backoff(volatile unsigned int *word, volatile int *waiting, unsigned int *spins,
+		const struct timespec *deadline)
+{
+	unsigned int n = (*spins)++;
+	struct timespec now, ts;
+	long ns;
+
+	if (likely(n < FASTQ_FULL_SPIN)) {
+		__relax();
+		/* 自旋期间偶尔检查一次超时 */
+		if (!deadline || (n & 127)) {
+			return true;
+		}
+	} else if (n < FASTQ_FULL_SPIN + FASTQ_FULL_YIELD) {
+		sched_yield();
+		if (!deadline) {
+			return true;
+		}
+	}
+
+	ns = FASTQ_FULL_SLEEP_US * 1000L;
+	if (deadline) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long left = (deadline->tv_sec - now.tv_sec) * 1000000000L
+					+ (deadline->tv_nsec - now.tv_nsec);
+		if (left <= 0) {
+			return false;
+		}
+		if (n < FASTQ_FULL_SPIN + FASTQ_FULL_YIELD) {
+			return true;
+		}
+		ns = min(ns, left);
+	}
+
+	/* 先读位置再置标志，期间位置变化时 futex 立即返回 */
+	unsigned int h = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+
+	__atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+
+	ts.tv_sec = ns / 1000000000L;
+	ts.tv_nsec = ns % 1000000000L;
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, h, &ts, NULL, 0);
+
+	return true;
+}
+
+/**
+ *  __fastq_full_wait - 生产者: 队列满时等待一次 _head 变化，见 __fastq_backoff
+ */
+static inline bool
+__fastq_full_wait(struct FastQRing *ring, unsigned int *spins,
+		const struct timespec *deadline)
+{
+	return __fastq_backoff(&ring->_head, &ring->_full_wait, spins, deadline);
+}
+
+/**
+ *  __fastq_deadline - 计算 timeout_us 微秒之后的 CLOCK_MONOTONIC 时间
+ */
+static inline void
+__fastq_deadline(struct timespec *deadline, unsigned long timeout_us)
+{
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += timeout_us / 1000000;
+	deadline->tv_nsec += (timeout_us % 1000000) * 1000;
+	if (deadline->tv_nsec >= 1000000000L) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+/**
+ *  __fastq_ow_drop - 覆盖队列 生产者: 丢弃最旧的一条消息，腾出一个节点
+ *
+ *  与消费者 CAS _head 竞争，CAS 之前先增加 _ow_gen，
+ *  消费者据此判断拷贝节点期间 _head 是否可能被推进了一整圈，见 __fastq_ow_recv
+ *
+ *  return 队列中只剩本次还没有发布的节点时 false
+ */
+static bool
+__fastq_ow_drop(struct FastQRing *ring)
+{
+	unsigned int h = ring->_head_cache;
+
+	if (h == ring->_tail) {
+		return false;
+	}
+
+	__atomic_add_fetch(&ring->_ow_gen, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_compare_exchange_n(&ring->_head, &h, (h + 1) & ring->_size, 0,
+			__ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+		h = (h + 1) & ring->_size;
+		__atomic_add_fetch(&ring->_dropped, 1, __ATOMIC_RELAXED);
+
+		//统计功能：入队数不回退，被覆盖的消息只计入丢弃数
+		__fastq_stat_add(ring->nr_overwrite, 1);
+	}
+	/* CAS 失败说明消费者刚刚取走了队首消息，同样腾出了节点 */
+	ring->_head_cache = h;
+	return true;
+}
+
+/**
+ *  __fastq_ring_notify - 生产者: 发布节点之后通知接收方
+ *
+ *  只有接收方读空队列并重新使能 (_armed) 之后，第一个看到 _armed 的生产者置一次就绪位，
+ *  其余消息接收方读空队列时一并处理；就绪位由空变为非空、接收线程睡眠时才敲门铃，
+ *  见 __fastq_module_ready；
+ *  忙轮询模式 下接收线程醒着时自己会读到消息，不使用就绪位，只在它睡眠 (_sleeping) 时敲门铃
+ *
+ *  生产者 发布节点 -> 全屏障 -> 读 _armed/_sleeping，接收线程 写 _armed/_sleeping -> 全屏障 -> 检查队列，
+ *  至少有一方能看到对方的写，不会丢失唤醒，见 __fastq_ring_rearm __fastq_recv_sleep；
+ *  FASTQ_MODULE_F_POLL_ONLY 接收线程从不睡眠，不需要通知，连屏障也省掉
+ */
+static inline void
+__fastq_ring_notify(struct FastQRing *ring)
+{
+	struct FastQModule *pmodule;
+
+	if (__fastq_is_poll_only(ring)) {
+		return;
+	}
+	/* 动态删除模块时，可能导致 src/dst 失效，见 __fastq_ring_drain */
+	if (unlikely(ring->dst > FASTQ_ID_MAX)) {
+		return;
+	}
+	pmodule = &_AllModulesRings[ring->dst];
+
+	if (__fastq_is_poll(ring)) {
+		__fastq_module_notify(pmodule);
+		return;
+	}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	/* 接收方还没有读空队列 */
+	if (likely(!__atomic_load_n(&ring->_armed, __ATOMIC_RELAXED))) {
+		return;
+	}
+	/* 多个生产者同时看到 _armed 时只有一个置就绪位 */
+	if (!__atomic_exchange_n(&ring->_armed, 0, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+	__fastq_module_ready(pmodule, ring->src);
+}
+
+/**
+ *  __fastq_full_drop - 队列满时是否按 _policy 丢弃消息（而不是轮询等待），丢弃时计数
+ */
+static inline bool
+__fastq_full_drop(struct FastQRing *ring, unsigned int prio, unsigned int n)
+{
+	switch (ring->_policy) {
+	case FASTQ_FULL_DROP_PRIO:
+		if (prio != FASTQ_PRIO_NORMAL) {
+			return false;
+		}
+		/* fallthrough */
+	case FASTQ_FULL_DROP_NEWEST:
+		__atomic_add_fetch(&ring->_dropped, n, __ATOMIC_RELAXED);
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ *  __fastq_ring_claim - 生产者: 在 *pos 处申请可以放下 size 字节消息的节点
+ *
+ *  变长队列 到队列末尾的空间放不下这条记录时，写入填充记录并回绕到队列起始处
+ *
+ *  return 节点地址，并将 *pos 更新为下一个节点的位置； 队列满时返回 NULL
+ */
+static inline char *
+__fastq_ring_claim(struct FastQRing *ring, unsigned int *pos, const size_t size)
+{
+	unsigned int t = *pos;
+
+	assert(size <= __fastq_ring_payload_max(ring));
+
+	if (!__fastq_is_varlen(ring)) {
+		while (!__fastq_ring_free(ring, t, 1)) {
+			if (!__fastq_is_ow(ring) || !__fastq_ow_drop(ring)) {
+				return NULL;
+			}
+		}
+		*pos = (t + 1) & ring->_size;
+		__builtin_prefetch(&ring->_ring_data[(*pos)*ring->_msg_size], 1);
+		return &ring->_ring_data[t*ring->_msg_size];
+	}
+
+	unsigned int len = __fastq_varlen_len(size);
+	unsigned int room = ring->_size + 1 - t;    //到队列末尾的字节数
+	unsigned int pad = room < len ? room : 0;
+
+	if (__fastq_ring_free(ring, t, pad + len) < pad + len) {
+		return NULL;
+	}
+	if (pad) {
+		((struct fastq_node_hdr *)&ring->_ring_data[t])->size = FASTQ_VARLEN_PAD;
+		t = 0;
+	}
+	*pos = (t + len) & ring->_size;
+	__builtin_prefetch(&ring->_ring_data[*pos], 1);
+	return &ring->_ring_data[t];
+}
+
+/**
+ *  __fastq_ring_next - 消费者: 读取 *pos 处的节点
+ *
+ *  变长队列 遇到填充记录时回绕到队列起始处
+ *
+ *  return 节点地址，并将 *pos 更新为下一个节点的位置； 队列空时返回 NULL
+ */
+static inline char *
+__fastq_ring_next(struct FastQRing *ring, unsigned int *pos)
+{
+	unsigned int h = *pos;
+	char *d;
+
+	if (__fastq_is_mp(ring)) {
+		/* 生产者可能还没写完 */
+		d = __fastq_mp_node(ring, h);
+		if (__atomic_load_n(&__fastq_mp_seq(d), __ATOMIC_ACQUIRE) != h + 1) {
+			return NULL;
+		}
+		*pos = h + 1;
+		__builtin_prefetch(__fastq_mp_node(ring, h + 1), 0);
+		return d;
+	}
+
+	if (!__fastq_ring_count(ring, h, 1)) {
+		return NULL;
+	}
+
+	if (!__fastq_is_varlen(ring)) {
+		*pos = (h + 1) & ring->_size;
+		__builtin_prefetch(&ring->_ring_data[(*pos)*ring->_msg_size], 0);
+		return &ring->_ring_data[h*ring->_msg_size];
+	}
+
+	d = &ring->_ring_data[h];
+	if (((struct fastq_node_hdr *)d)->size == FASTQ_VARLEN_PAD) {
+		h = 0;
+		d = ring->_ring_data;
+	}
+	*pos = (h + __fastq_varlen_len(((struct fastq_node_hdr *)d)->size)) & ring->_size;
+	__builtin_prefetch(&ring->_ring_data[*pos], 0);
+	return d;
+}
+
+static inline void
+__fastq_ring_fill_hdr(char *d, unsigned long msgType,
+		unsigned long msgCode, unsigned long msgSubCode, const size_t size)
+{
+	struct fastq_node_hdr *hdr = (struct fastq_node_hdr *)d;
+
+	/* 发送接口已经拒绝了超出 FASTQ_HDR_FIELD_BITS 的值 */
+	assert(__fastq_hdr_fits(msgType, msgCode, msgSubCode) && "header field out of range");
+
+	hdr->size = size;
+	hdr->type = msgType;
+	hdr->code = msgCode;
+	hdr->subcode = msgSubCode;
+}
+
+static inline void
+__fastq_ring_fill(char *d, unsigned long msgType,
+		unsigned long msgCode, unsigned long msgSubCode,
+		const void *msg, const size_t size)
+{
+	__fastq_ring_fill_hdr(d, msgType, msgCode, msgSubCode, size);
+
+	memcpy(d + FASTQ_NODE_HDR_SIZE, msg, size);
+}
+
+/**
+ *  __FastQSendMP - 多入单出队列 发送函数
+ *
+ *  一次 CAS 申请尽可能多的节点，逐个写入并发布
+ *
+ *  return 实际入队的消息数
+ */
+static unsigned int
+__FastQSendMP(struct FastQRing *ring, const struct FastQBatchMsg *msgs,
+		unsigned int num)
+{
+	unsigned int t, n, i;
+	char *d;
+
+	n = __fastq_mp_claim(ring, &t, num);
+
+	//统计功能
+	__fastq_stat_add_mp(ring->nr_enqueue, n);
+
+	for (i = 0; i < n; i++) {
+		assert(msgs[i].size <= __fastq_ring_payload_max(ring));
+
+		d = __fastq_mp_node(ring, t + i);
+		__fastq_ring_fill(d, msgs[i].msgType, msgs[i].msgCode,
+				msgs[i].msgSubCode, msgs[i].msg, msgs[i].size);
+		__fastq_mp_publish(d, t + i);
+	}
+	return n;
+}
+
+static bool
+__FastQSend(struct FastQRing *ring, unsigned long msgType,
+		unsigned long msgCode, unsigned long msgSubCode,
+		const void *msg, const size_t size)
+{
+	assert(ring);
+
+	if (__fastq_is_mp(ring)) {
+		struct FastQBatchMsg one = {
+			.msgType = msgType,
+			.msgCode = msgCode,
+			.msgSubCode = msgSubCode,
+			.msg = msg,
+			.size = size,
+		};
+		return __FastQSendMP(ring, &one, 1) == 1;
+	}
+
+	unsigned int t = ring->_tail;
+	char *d = __fastq_ring_claim(ring, &t, size);
+
+	if (!d) {
+		return false;
+	}
+
+	__fastq_ring_fill(d, msgType, msgCode, msgSubCode, msg, size);
+
+	// Barrier is needed to make sure that item is updated
+	// before it's made available to the reader
+	mwbarrier();
+
+	//统计功能
+	__fastq_stat_add(ring->nr_enqueue, 1);
+
+	ring->_tail = t;
+	return true;
+}
+
+/**
+ *  __FastQSendBatch - 公共批量发送函数
+ *
+ *  尽可能多地将 msgs 拷贝进 ring，只发布一次 _tail，只更新一次统计
+ *
+ *  return 实际入队的消息数
+ */
+static unsigned int
+__FastQSendBatch(struct FastQRing *ring, const struct FastQBatchMsg *msgs,
+		unsigned int num)
+{
+	assert(ring);
+
+	if (__fastq_is_mp(ring)) {
+		return __FastQSendMP(ring, msgs, num);
+	}
+
+	unsigned int t = ring->_tail;
+	unsigned int n;
+	char *d;
+
+	for (n = 0; n < num; n++) {
+		d = __fastq_ring_claim(ring, &t, msgs[n].size);
+		if (!d) {
+			break;
+		}
+		__fastq_ring_fill(d, msgs[n].msgType, msgs[n].msgCode,
+				msgs[n].msgSubCode, msgs[n].msg, msgs[n].size);
+	}
+	if (unlikely(!n)) {
+		return 0;
+	}
+
+	mwbarrier();
+
+	//统计功能
+	__fastq_stat_add(ring->nr_enqueue, n);
+
+	ring->_tail = t;
+	return n;
+}
+
+/**
+ *  多入单出队列 的 FastQReserve 申请记录在线程私有变量中，
+ *  每个线程同时只能有一个未提交的申请
+ */
+static __thread struct {
+	struct FastQRing *ring;
+	char *node;
+	unsigned int pos;
+} __fastq_mp_reserved;
+
+/**
+ *  __FastQReserve - 申请下一个空闲节点的消息体地址，队列满时返回 NULL
+ */
+static void *
+__FastQReserve(struct FastQRing *ring, const size_t size)
+{
+	assert(ring);
+
+	if (__fastq_is_mp(ring)) {
+		unsigned int pos;
+
+		assert(!__fastq_mp_reserved.ring && "Reserve twice without commit.");
+		assert(size <= __fastq_ring_payload_max(ring));
+
+		if (!__fastq_mp_claim(ring, &pos, 1)) {
+			return NULL;
+		}
+		__fastq_mp_reserved.ring = ring;
+		__fastq_mp_reserved.node = __fastq_mp_node(ring, pos);
+		__fastq_mp_reserved.pos = pos;
+
+		return __fastq_mp_reserved.node + FASTQ_NODE_HDR_SIZE;
+	}
+
+	unsigned int t = ring->_tail;
+
+	ring->_reserved = __fastq_ring_claim(ring, &t, size);
+	if (!ring->_reserved) {
+		return NULL;
+	}
+
+	return ring->_reserved + FASTQ_NODE_HDR_SIZE;
+}
+
+/**
+ *  __FastQCommit - 填写 __FastQReserve 申请的节点头，并发布给接收方
+ */
+static void
+__FastQCommit(struct FastQRing *ring, unsigned long msgType,
+		unsigned long msgCode, unsigned long msgSubCode, const size_t size)
+{
+	char *d = ring->_reserved;
+	unsigned int t;
+
+	if (__fastq_is_mp(ring)) {
+		assert(__fastq_mp_reserved.ring == ring && "Commit without reserve.");
+		assert(size <= __fastq_ring_payload_max(ring));
+
+		d = __fastq_mp_reserved.node;
+		__fastq_ring_fill_hdr(d, msgType, msgCode, msgSubCode, size);
+
+		//统计功能
+		__fastq_stat_add_mp(ring->nr_enqueue, 1);
+
+		__fastq_mp_reserved.ring = NULL;
+		__fastq_mp_publish(d, __fastq_mp_reserved.pos);
+		return;
+	}
+
+	assert(d && "Commit without reserve.");
+	assert(size <= __fastq_ring_payload_max(ring));
+
+	/* 变长队列 按实际大小计算下一条记录的位置 */
+	if (__fastq_is_varlen(ring)) {
+		t = (d - ring->_ring_data + __fastq_varlen_len(size)) & ring->_size;
+	} else {
+		t = (ring->_tail + 1) & ring->_size;
+	}
+
+	__fastq_ring_fill_hdr(d, msgType, msgCode, msgSubCode, size);
+
+	mwbarrier();
+
+	//统计功能
+	__fastq_stat_add(ring->nr_enqueue, 1);
+
+	ring->_reserved = NULL;
+	ring->_tail = t;
+}
+
+static struct FastQRing *
+__create_ring_when_send(unsigned int from, unsigned int to) {
+
+	struct FastQRing *ring = NULL;
+	struct FastQModule *dst_module = &_AllModulesRings[to];
+
+	/**
+	 *  多入单出队列 的多个发送线程可能同时发送第一条消息，
+	 *  只能有一个线程创建环形队列
+	 */
+	pthread_rwlock_wrlock(&dst_module->rx.rwlock);
+
+	ring = __atomic_load_n(&dst_module->_ring[from], __ATOMIC_RELAXED);
+	if (ring) {
+		pthread_rwlock_unlock(&dst_module->rx.rwlock);
+		return ring;
+	}
+
+	/* 创建环形队列 */
+	__fastq_create_ring(dst_module, from, to);
+
+	ring = __atomic_load_n(&dst_module->_ring[from], __ATOMIC_RELAXED);
+
+	MOD_SET(from, &dst_module->rx.set);
+	pthread_rwlock_unlock(&dst_module->rx.rwlock);
+
+	MOD_SET(to, &_AllModulesRings[from].tx.set);
+
+	return ring;
+}
+
+/**
+ *  __fastq_ring_resize - 生产者: 用 ring_size 大小的新队列替换 ring
+ *
+ *  不拷贝消息：新队列共用就绪位和高优先级队列，生产者此后只写新队列，
+ *  消费者把旧队列读空后切换到新队列并释放旧队列，见 __fastq_ring_migrate；
+ *  替换后唤醒一次接收方
+ */
+static struct FastQRing *
+__fastq_ring_resize(struct FastQRing *ring, const unsigned int ring_size,
+		const unsigned int msg_size)
+{
+	struct FastQModule *pmodule = &_AllModulesRings[ring->dst];
+	struct FastQRing *new_ring;
+
+	fastq_log("Resize ring : src(%lu)->dst(%lu) ringsize(%d)->(%d).\n",
+		ring->src, ring->dst, ring->_size + 1, ring_size);
+
+	const unsigned int policy = __fastq_edge_policy(pmodule, ring->src);
+
+	new_ring = __fastq_ring_alloc(ring->src, ring->dst,
+				(ring->_flags & ~FASTQ_RING_F_OVERWRITE) |
+				(policy == FASTQ_FULL_OVERWRITE ? FASTQ_RING_F_OVERWRITE : 0),
+				ring_size, msg_size);
+	new_ring->_rx = ring->_rx;
+	new_ring->_policy = policy;
+	new_ring->_prio = ring->_prio;
+	new_ring->_dropped = ring->_dropped;
+#if defined(_FASTQ_STATS)
+	new_ring->nr_enqueue = ring->nr_enqueue;
+	new_ring->nr_overwrite = ring->nr_overwrite;
+#endif
+
+	__atomic_store_n(&pmodule->_ring[ring->src], new_ring, __ATOMIC_SEQ_CST);
+
+	/* 替换期间配置线程标记的是旧队列，转给新队列，见 __fastq_ring_mark；
+	 * 要在 _next 之前，之后消费者随时可能释放旧队列 */
+	__atomic_or_fetch(&new_ring->_reconf,
+			__atomic_load_n(&ring->_reconf, __ATOMIC_SEQ_CST), __ATOMIC_RELAXED);
+
+	/* 旧队列的最后一次发布 先于 _next 可见 */
+	__atomic_store_n(&ring->_next, new_ring, __ATOMIC_RELEASE);
+
+	/* 唤醒接收方，旧队列已读空时也能及时切换并释放旧队列，见 __fastq_ring_drain */
+	if (__fastq_is_poll(ring)) {
+		__fastq_module_notify(pmodule);
+	} else {
+		__fastq_module_ready(pmodule, ring->src);
+	}
+
+	return new_ring;
+}
+
+/**
+ *  __fastq_ring_resizable - 只有单入单出、没有未提交的 FastQReserve 的队列可以替换
+ */
+static inline bool
+__fastq_ring_resizable(struct FastQRing *ring)
+{
+	return !(ring->_flags & (FASTQ_MODULE_F_MPSC | FASTQ_MODULE_F_MULTI_CONSUMER))
+			&& !ring->_reserved;
+}
+
+/**
+ *  __fastq_ring_reconf - 生产者: 按 FastQConfigureEdge/FastQSetFullPolicy 的新配置替换队列
+ *
+ *  与自动扩容相同，只在生产者线程中替换，此时没有正在写旧队列的生产者；
+ *  有未提交的 FastQReserve 时保留标记，提交之后的下一次发送再替换
+ *
+ *  return 替换后的新队列，只修改了 _policy 或者不能替换时返回 NULL
+ */
+static struct FastQRing *
+__fastq_ring_reconf(struct FastQRing *ring)
+{
+	struct FastQModule *pmodule = &_AllModulesRings[ring->dst];
+	unsigned int policy;
+	int what;
+
+	if (unlikely(ring->_reserved)) {
+		return NULL;
+	}
+	what = __atomic_exchange_n(&ring->_reconf, 0, __ATOMIC_SEQ_CST);
+	policy = __fastq_edge_policy(pmodule, ring->src);
+
+	/* 覆盖队列 的接收方式不同，切换时需要替换队列 */
+	if (((what & FASTQ_RECONF_SIZE) ||
+		(policy == FASTQ_FULL_OVERWRITE) != !!__fastq_is_ow(ring)) &&
+		__fastq_ring_resizable(ring)) {
+		return __fastq_ring_resize(ring, __fastq_edge_ring_size(pmodule, ring->src),
+				__fastq_edge_msg_size(pmodule, ring->src));
+	}
+	__atomic_store_n(&ring->_policy, policy, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+/**
+ *  __fastq_ring_mark - 配置线程: 标记 src 发往该模块的队列，生产者下一次发送时按新配置替换
+ *
+ *  调用者持有 rx.rwlock 写锁，接收者释放旧队列前要拿读锁，见 __fastq_ring_migrate；
+ *  标记后重新读一次，生产者正好替换了队列时也标记新队列，见 __fastq_ring_resize
+ */
+static void
+__fastq_ring_mark(struct FastQModule *pmodule, const unsigned long src, int what)
+{
+	struct FastQRing *ring, *next = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_SEQ_CST);
+
+	while ((ring = next)) {
+		__atomic_or_fetch(&ring->_reconf, what, __ATOMIC_SEQ_CST);
+
+		next = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_SEQ_CST);
+		if (next == ring) {
+			break;
+		}
+	}
+}
+
+/**
+ *  __fastq_ring_grow - 生产者: 队列满时先应用修改过的配置，再按 FASTQ_MODULE_F_AUTO_GROW 扩容一倍
+ *
+ *  return 替换或扩容后的新队列，不能扩容时返回 NULL
+ */
+static struct FastQRing *
+__fastq_ring_grow(struct FastQRing *ring)
+{
+	struct FastQRing *next;
+
+	if (unlikely(__atomic_load_n(&ring->_reconf, __ATOMIC_RELAXED)) &&
+		(next = __fastq_ring_reconf(ring))) {
+		return next;
+	}
+	if (likely(!(ring->_flags & FASTQ_MODULE_F_AUTO_GROW))) {
+		return NULL;
+	}
+	if (ring->_size + 1 >= _AllModulesRings[ring->dst].ring_max ||
+		!__fastq_ring_resizable(ring)) {
+		return NULL;
+	}
+	return __fastq_ring_resize(ring, (ring->_size + 1) * 2,
+			__fastq_edge_msg_size(&_AllModulesRings[ring->dst], ring->src));
+}
+
+/**
+ *  FastQResizeRing - 修改队列大小
+ */
+bool
+FastQResizeRing(unsigned int dst, unsigned int src, unsigned int msgMax)
+{
+	if (unlikely(dst <= 0 || dst > FASTQ_ID_MAX || src > FASTQ_ID_MAX) || !msgMax) {
+		return false;
+	}
+
+	struct FastQModule *pmodule = &_AllModulesRings[dst];
+	struct FastQRing *ring = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_ACQUIRE);
+
+	if (unlikely(!ring) || !__fastq_ring_resizable(ring)) {
+		return false;
+	}
+
+	const unsigned int msg_size = __fastq_edge_msg_size(pmodule, src);
+	unsigned int ring_size = __power_of_2(msgMax);
+
+	if (__fastq_is_varlen(ring)) {
+		ring_size = __fastq_varlen_bytes(msgMax * __fastq_varlen_len(msg_size), msg_size);
+	}
+	if (ring_size != ring->_size + 1) {
+		__fastq_ring_resize(ring, ring_size, msg_size);
+	}
+	return true;
+}
+
+/**
+ *  __fastq_tx_ring - 生产者: from 发往 to 的队列，不存在时创建，配置修改过时先替换
+ */
+static inline struct FastQRing *
+__fastq_tx_ring(unsigned int from, unsigned int to)
+{
+	struct FastQRing *ring = __atomic_load_n(&_AllModulesRings[to]._ring[from], __ATOMIC_RELAXED);
+	struct FastQRing *next;
+
+	if (unlikely(!ring)) {
+		return __create_ring_when_send(from, to);
+	}
+	if (unlikely(__atomic_load_n(&ring->_reconf, __ATOMIC_RELAXED)) &&
+		(next = __fastq_ring_reconf(ring))) {
+		ring = next;
+	}
+	return ring;
+}
+
+/**
+ *  __fastq_edge_table - 获取模块的按源模块配置表，不存在时创建
+ */
+static struct fastq_edge *
+__fastq_edge_table(struct FastQModule *pmodule)
+{
+	struct fastq_edge *edge = __atomic_load_n(&pmodule->_edge, __ATOMIC_ACQUIRE);
+	struct fastq_edge *expect = NULL;
+
+	if (likely(edge)) {
+		return edge;
+	}
+
+	edge = FastQMalloc(sizeof(struct fastq_edge)*(FASTQ_ID_MAX+1));
+	assert(edge && "Malloc Failed: Out of Memory.");
+	memset(edge, 0x00, sizeof(struct fastq_edge)*(FASTQ_ID_MAX+1));
+
+	if (!__atomic_compare_exchange_n(&pmodule->_edge, &expect, edge, 0,
+			__ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+		FastQFree(edge);
+		edge = expect;
+	}
+	return edge;
+}
+
+/**
+ *  FastQConfigureEdge - 配置 src 发往 dst 的队列大小
+ */
+bool
+FastQConfigureEdge(unsigned int src, unsigned int dst,
+		unsigned int msgMax, unsigned int msgSize)
+{
+	if (unlikely(dst <= 0 || dst > FASTQ_ID_MAX || src > FASTQ_ID_MAX)) {
+		return false;
+	}
+
+	struct FastQModule *pmodule = &_AllModulesRings[dst];
+	struct fastq_edge *edge = __fastq_edge_table(pmodule);
+	struct FastQRing *ring;
+
+	pthread_rwlock_wrlock(&pmodule->rx.rwlock);
+
+	ring = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_ACQUIRE);
+	if (ring && (ring->_flags & (FASTQ_MODULE_F_MPSC | FASTQ_MODULE_F_MULTI_CONSUMER))) {
+		pthread_rwlock_unlock(&pmodule->rx.rwlock);
+		fastq_log("Ring src(%u)->dst(%u) already in use, can not configure.\n", src, dst);
+		return false;
+	}
+
+	edge[src].msg_max = msgMax;
+	edge[src].msg_size = msgSize;
+
+	/* 已经创建的队列，由生产者在下一次发送时按新的配置替换 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	__fastq_ring_mark(pmodule, src, FASTQ_RECONF_SIZE);
+
+	pthread_rwlock_unlock(&pmodule->rx.rwlock);
+
+	return true;
+}
+
+/**
+ *  FastQSetFullPolicy - 配置 src 发往 dst 的队列满时的处理策略
+ */
+bool
+FastQSetFullPolicy(unsigned int src, unsigned int dst, unsigned int policy)
+{
+	if (unlikely(dst <= 0 || dst > FASTQ_ID_MAX || src > FASTQ_ID_MAX) ||
+		unlikely(policy > FASTQ_FULL_DROP_PRIO)) {
+		return false;
+	}
+
+	struct FastQModule *pmodule = &_AllModulesRings[dst];
+	struct fastq_edge *edge;
+	struct FastQRing *ring;
+	unsigned int old_policy;
+
+	if (policy == FASTQ_FULL_OVERWRITE && (pmodule->flags & FASTQ_MODULE_F_VARLEN)) {
+		fastq_log("Variable-length ring src(%u)->dst(%u) can not be overwritten.\n", src, dst);
+		return false;
+	}
+	if (policy == FASTQ_FULL_OVERWRITE &&
+		((pmodule->flags | _AllModulesRings[src].flags) & FASTQ_MODULE_F_MPSC)) {
+		fastq_log("Multi-producer ring src(%u)->dst(%u) can not be overwritten.\n", src, dst);
+		return false;
+	}
+
+	edge = __fastq_edge_table(pmodule);
+
+	pthread_rwlock_wrlock(&pmodule->rx.rwlock);
+
+	old_policy = edge[src].policy;
+	edge[src].policy = policy + 1;
+
+	ring = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_ACQUIRE);
+	policy = __fastq_edge_policy(pmodule, src);
+
+	/* 覆盖队列 的接收方式不同，需要替换队列 */
+	if (ring && (policy == FASTQ_FULL_OVERWRITE) != !!__fastq_is_ow(ring) &&
+		(ring->_flags & (FASTQ_MODULE_F_MPSC | FASTQ_MODULE_F_MULTI_CONSUMER))) {
+		edge[src].policy = old_policy;
+		pthread_rwlock_unlock(&pmodule->rx.rwlock);
+		fastq_log("Ring src(%u)->dst(%u) already in use, can not configure.\n", src, dst);
+		return false;
+	}
+
+	/* 已经创建的队列，由生产者在下一次发送时切换策略或者替换队列，见 __fastq_ring_reconf；
+	 * 不替换队列时 _policy 直接生效，阻塞在队列满的生产者也能看到 */
+	if (ring && (policy == FASTQ_FULL_OVERWRITE) == !!__fastq_is_ow(ring)) {
+		__atomic_store_n(&ring->_policy, policy, __ATOMIC_RELAXED);
+	}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	__fastq_ring_mark(pmodule, src, FASTQ_RECONF_POLICY);
+
+	pthread_rwlock_unlock(&pmodule->rx.rwlock);
+
+	return true;
+}
+
+/**
+ *  __FastQSendWait - 发送消息，队列满时按 __fastq_full_wait 等待，直到 deadline
+ */
+static bool
+__FastQSendWait(unsigned int from, unsigned int to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size, const struct timespec *deadline)
+{
+	if (unlikely(!__fastq_hdr_fits(msgType, msgCode, msgSubCode))) {
+		return false;
+	}
+
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+	struct FastQRing *next;
+	unsigned int spins = 0;
+
+	while (!__FastQSend(ring, msgType, msgCode, msgSubCode, msg, size)) {
+		if ((next = __fastq_ring_grow(ring))) {
+			ring = next;
+			continue;
+		}
+		if (__fastq_full_drop(ring, FASTQ_PRIO_NORMAL, 1)) {
+			return false;
+		}
+		if (!__fastq_full_wait(ring, &spins, deadline)) {
+			return false;
+		}
+	}
+
+	__fastq_ring_notify(ring);
+
+	return true;
+}
+
+/**
+ *  FastQSend - 发送消息（轮询直至成功发送）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   msg     传递的消息体
+ *  param[in]   size    传递的消息大小
+ *
+ *  return 成功true （轮询直至发送成功；FASTQ_FULL_DROP_* 策略下队列满时丢弃并返回 false）
+ *
+ *  注意：from 和 to 需要使用 FastQCreateModule 注册后使用
+ */
+bool
+FastQSend(unsigned int from, unsigned int to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size)
+{
+	return __FastQSendWait(from, to, msgType, msgCode, msgSubCode, msg, size, NULL);
+}
+
+/**
+ *  FastQSendTimed - 发送消息（队列满时最多等待 timeout_us 微秒）
+ */
+bool
+FastQSendTimed(unsigned int from, unsigned int to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size, unsigned long timeout_us)
+{
+	struct timespec deadline;
+
+	__fastq_deadline(&deadline, timeout_us);
+
+	return __FastQSendWait(from, to, msgType, msgCode, msgSubCode, msg, size, &deadline);
+}
+
+bool
+FastQSendByName(const char* from, const char* to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size)
+{
+	assert(from && "NULL string.");
+	assert(to && "NULL string.");
+
+	unsigned long from_id = dict_find_module_id_byname((char *)from);
+	unsigned long to_id = dict_find_module_id_byname((char *)to);
+
+	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
+		return false;
+	} if(unlikely(!__atomic_load_n(&_AllModulesRings[to_id].already_register, __ATOMIC_RELAXED))) {
+		return false;
+	}
+	return FastQSend(from_id, to_id, msgType, msgCode, msgSubCode, msg, size);
+}
+
+/**
+ *  FastQTrySend - 发送消息（尝试向队列中插入，当队列满是直接返回false）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   msg     传递的消息体
+ *  param[in]   size    传递的消息大小
+ *
+ *  return 成功true 失败false
+ *
+ *  注意：from 和 to 需要使用 FastQCreateModule 注册后使用
+ */
+bool
+FastQTrySend(unsigned int from, unsigned int to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size)
+{
+	if (unlikely(!__fastq_hdr_fits(msgType, msgCode, msgSubCode))) {
+		return false;
+	}
+
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+	struct FastQRing *next;
+	bool ret = __FastQSend(ring, msgType, msgCode, msgSubCode, msg, size);
+	if(!ret && (next = __fastq_ring_grow(ring))) {
+		ring = next;
+		ret = __FastQSend(ring, msgType, msgCode, msgSubCode, msg, size);
+	}
+	if(ret) {
+		__fastq_ring_notify(ring);
+	} else {
+		__fastq_full_drop(ring, FASTQ_PRIO_NORMAL, 1);
+	}
+	return ret;
+}
+
+bool
+FastQTrySendByName(const char* from, const char* to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size)
+{
+	assert(from && "NULL string.");
+	assert(to && "NULL string.");
+	unsigned long from_id = dict_find_module_id_byname((char *)from);
+	unsigned long to_id = dict_find_module_id_byname((char *)to);
+	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
+		return false;
+	} if(unlikely(!__atomic_load_n(&_AllModulesRings[to_id].already_register, __ATOMIC_RELAXED))) {
+		return false;
+	}
+
+	return FastQTrySend(from_id, to_id, msgType, msgCode, msgSubCode, msg, size);
+}
+
+/**
+ *  __fastq_prio_ring - 获取 ring 的高优先级队列，不存在时创建
+ *
+ *  多入单出队列 的多个发送线程可能同时创建，只保留一个
+ */
+static struct FastQRing *
+__fastq_prio_ring(struct FastQRing *ring)
+{
+	struct FastQRing *hi = __atomic_load_n(&ring->_prio, __ATOMIC_ACQUIRE);
+	struct FastQRing *expect = NULL;
+
+	if (likely(hi)) {
+		return hi;
+	}
+
+	fastq_log("Create priority ring : src(%lu)->dst(%lu) ringsize(%d).\n",
+		ring->src, ring->dst, FASTQ_PRIO_RING_SIZE);
+
+	/* 高优先级队列 固定为定长、不覆盖的队列，与普通队列共用 _armed 和就绪位 */
+	hi = __fastq_ring_alloc(ring->src, ring->dst,
+			ring->_flags & ~(FASTQ_MODULE_F_VARLEN | FASTQ_RING_F_OVERWRITE),
+			__power_of_2(FASTQ_PRIO_RING_SIZE),
+			__fastq_edge_msg_size(&_AllModulesRings[ring->dst], ring->src));
+	hi->_rx = ring->_rx;
+	/* 接收方只重新使能普通队列的 _armed，由 __FastQSendPrio 通知 */
+	hi->_armed = 0;
+
+	if (!__atomic_compare_exchange_n(&ring->_prio, &expect, hi, 0,
+			__ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+		FastQFree(hi);
+		hi = expect;
+	}
+	return hi;
+}
+
+/**
+ *  __FastQSendPrio - 发送高优先级消息
+ */
+static bool
+__FastQSendPrio(struct FastQRing *ring, unsigned long msgType,
+		unsigned long msgCode, unsigned long msgSubCode,
+		const void *msg, const size_t size)
+{
+	if (!__FastQSend(__fastq_prio_ring(ring), msgType, msgCode, msgSubCode, msg, size)) {
+		return false;
+	}
+	/* 先计数再通知，接收方取到就绪位时一定能看到计数 */
+	__atomic_add_fetch(&_AllModulesRings[ring->dst]._prio_pending, 1, __ATOMIC_RELAXED);
+	__fastq_ring_notify(ring);
+	return true;
+}
+
+/**
+ *  __FastQSendPrioWait - 按优先级发送消息，队列满时按 __fastq_full_wait 等待，直到 deadline
+ */
+static bool
+__FastQSendPrioWait(unsigned int from, unsigned int to, unsigned int prio,
+				unsigned long msgType, unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size, const struct timespec *deadline)
+{
+	assert(prio <= FASTQ_PRIO_HIGH && "Invalid priority.");
+
+	if (prio == FASTQ_PRIO_NORMAL) {
+		return __FastQSendWait(from, to, msgType, msgCode, msgSubCode, msg, size, deadline);
+	}
+	if (unlikely(!__fastq_hdr_fits(msgType, msgCode, msgSubCode))) {
+		return false;
+	}
+
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+	unsigned int spins = 0;
+
+	while (!__FastQSendPrio(ring, msgType, msgCode, msgSubCode, msg, size)) {
+		if (__fastq_full_drop(ring, prio, 1)) {
+			return false;
+		}
+		if (!__fastq_full_wait(__fastq_prio_ring(ring), &spins, deadline)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ *  FastQSendPrio - 按优先级发送消息（轮询直至成功发送）
+ */
+bool
+FastQSendPrio(unsigned int from, unsigned int to, unsigned int prio,
+				unsigned long msgType, unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size)
+{
+	return __FastQSendPrioWait(from, to, prio, msgType, msgCode, msgSubCode, msg, size, NULL);
+}
+
+/**
+ *  FastQSendPrioTimed - 按优先级发送消息（队列满时最多等待 timeout_us 微秒）
+ */
+bool
+FastQSendPrioTimed(unsigned int from, unsigned int to, unsigned int prio,
+				unsigned long msgType, unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size, unsigned long timeout_us)
+{
+	struct timespec deadline;
+
+	__fastq_deadline(&deadline, timeout_us);
+
+	return __FastQSendPrioWait(from, to, prio, msgType, msgCode, msgSubCode, msg, size,
+				&deadline);
+}
+
+/**
+ *  FastQTrySendPrio - 按优先级发送消息（队列满时直接返回false）
+ */
+bool
+FastQTrySendPrio(unsigned int from, unsigned int to, unsigned int prio,
+				unsigned long msgType, unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size)
+{
+	assert(prio <= FASTQ_PRIO_HIGH && "Invalid priority.");
+
+	if (prio == FASTQ_PRIO_NORMAL) {
+		return FastQTrySend(from, to, msgType, msgCode, msgSubCode, msg, size);
+	}
+	if (unlikely(!__fastq_hdr_fits(msgType, msgCode, msgSubCode))) {
+		return false;
+	}
+
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+	/* __FastQSendPrio 已经通知接收方 */
+	bool ret = __FastQSendPrio(ring, msgType, msgCode, msgSubCode, msg, size);
+	if(!ret) {
+		__fastq_full_drop(ring, prio, 1);
+	}
+	return ret;
+}
+
+/**
+ *  __fastq_batch_fits - msgs 中前多少条消息的消息头字段不超出 FASTQ_HDR_FIELD_BITS
+ */
+static inline unsigned int
+__fastq_batch_fits(const struct FastQBatchMsg *msgs, unsigned int num)
+{
+#if FASTQ_HDR_FIELD_BITS < 64
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		if (unlikely(!__fastq_hdr_fits(msgs[i].msgType, msgs[i].msgCode, msgs[i].msgSubCode))) {
+			return i;
+		}
+	}
+#endif
+	return num;
+}
+
+/**
+ *  __FastQSendBatchWait - 批量发送消息，队列满时按 __fastq_full_wait 等待，直到 deadline
+ *
+ *  每次入队最多通知一次，接收方已经在读这个队列时不置就绪位
+ */
+static unsigned int
+__FastQSendBatchWait(unsigned int from, unsigned int to,
+				const struct FastQBatchMsg *msgs, unsigned int num,
+				const struct timespec *deadline)
+{
+	assert(msgs && "NULL pointer error.");
+
+	num = __fastq_batch_fits(msgs, num);
+
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+
+	struct FastQRing *next;
+	unsigned int n, sent = 0, spins = 0;
+
+	while (sent < num) {
+		n = __FastQSendBatch(ring, msgs + sent, num - sent);
+		if (unlikely(!n)) {
+			if ((next = __fastq_ring_grow(ring))) {
+				ring = next;
+				continue;
+			}
+			if (__fastq_full_drop(ring, FASTQ_PRIO_NORMAL, num - sent)) {
+				break;
+			}
+			if (!__fastq_full_wait(ring, &spins, deadline)) {
+				break;
+			}
+			continue;
+		}
+		/* 队列可能小于批量大小，需要先通知接收方，再继续轮询 */
+		__fastq_ring_notify(ring);
+		sent += n;
+	}
+
+	return sent;
+}
+
+/**
+ *  FastQSendBatch - 批量发送消息（轮询直至全部发送）
+ */
+unsigned int
+FastQSendBatch(unsigned int from, unsigned int to,
+				const struct FastQBatchMsg *msgs, unsigned int num)
+{
+	return __FastQSendBatchWait(from, to, msgs, num, NULL);
+}
+
+/**
+ *  FastQSendBatchTimed - 批量发送消息（队列满时最多等待 timeout_us 微秒）
+ */
+unsigned int
+FastQSendBatchTimed(unsigned int from, unsigned int to,
+				const struct FastQBatchMsg *msgs, unsigned int num, unsigned long timeout_us)
+{
+	struct timespec deadline;
+
+	__fastq_deadline(&deadline, timeout_us);
+
+	return __FastQSendBatchWait(from, to, msgs, num, &deadline);
+}
+
+unsigned int
+FastQSendBatchByName(const char* from, const char* to,
+				const struct FastQBatchMsg *msgs, unsigned int num)
+{
+	assert(from && "NULL string.");
+	assert(to && "NULL string.");
+
+	unsigned long from_id = dict_find_module_id_byname((char *)from);
+	unsigned long to_id = dict_find_module_id_byname((char *)to);
+
+	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
+		return 0;
+	} if(unlikely(!__atomic_load_n(&_AllModulesRings[to_id].already_register, __ATOMIC_RELAXED))) {
+		return 0;
+	}
+	return FastQSendBatch(from_id, to_id, msgs, num);
+}
+
+/**
+ *  FastQTrySendBatch - 批量发送消息（队列满时直接返回）
+ *
+ *  return 实际发送的消息数，msgs[0 .. return-1] 已发送
+ */
+unsigned int
+FastQTrySendBatch(unsigned int from, unsigned int to,
+				const struct FastQBatchMsg *msgs, unsigned int num)
+{
+	assert(msgs && "NULL pointer error.");
+
+	num = __fastq_batch_fits(msgs, num);
+	if (unlikely(!num)) {
+		return 0;
+	}
+
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+	struct FastQRing *next;
+	unsigned int n = __FastQSendBatch(ring, msgs, num);
+	if(n < num && (next = __fastq_ring_grow(ring))) {
+		/* 旧队列放不下的部分发往新队列，新旧队列共用就绪位 */
+		ring = next;
+		n += __FastQSendBatch(ring, msgs + n, num - n);
+	}
+	if(n) {
+		__fastq_ring_notify(ring);
+	}
+	if(n < num) {
+		__fastq_full_drop(ring, FASTQ_PRIO_NORMAL, num - n);
+	}
+	return n;
+}
+
+unsigned int
+FastQTrySendBatchByName(const char* from, const char* to,
+				const struct FastQBatchMsg *msgs, unsigned int num)
+{
+	assert(from && "NULL string.");
+	assert(to && "NULL string.");
+	unsigned long from_id = dict_find_module_id_byname((char *)from);
+	unsigned long to_id = dict_find_module_id_byname((char *)to);
+	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
+		return 0;
+	} if(unlikely(!__atomic_load_n(&_AllModulesRings[to_id].already_register, __ATOMIC_RELAXED))) {
+		return 0;
+	}
+
+	return FastQTrySendBatch(from_id, to_id, msgs, num);
+}
+
+/**
+ *  __FastQReserveWait - 申请发送节点，队列满时按 __fastq_full_wait 等待，直到 deadline
+ *
+ *  return 队列节点中消息体的地址，调用者可直接写入，再调用 FastQCommit 发送
+ */
+static void *
+__FastQReserveWait(unsigned int from, unsigned int to, size_t size,
+				const struct timespec *deadline)
+{
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+
+	void *msg;
+
+	struct FastQRing *next;
+	unsigned int spins = 0;
+
+	while (!(msg = __FastQReserve(ring, size))) {
+		if ((next = __fastq_ring_grow(ring))) {
+			ring = next;
+			continue;
+		}
+		if (__fastq_full_drop(ring, FASTQ_PRIO_NORMAL, 1)) {
+			return NULL;
+		}
+		if (!__fastq_full_wait(ring, &spins, deadline)) {
+			return NULL;
+		}
+	}
+
+	return msg;
+}
+
+/**
+ *  FastQReserve - 申请发送节点（轮询直至申请成功）
+ */
+void *
+FastQReserve(unsigned int from, unsigned int to, size_t size)
+{
+	return __FastQReserveWait(from, to, size, NULL);
+}
+
+/**
+ *  FastQReserveTimed - 申请发送节点（队列满时最多等待 timeout_us 微秒）
+ */
+void *
+FastQReserveTimed(unsigned int from, unsigned int to, size_t size, unsigned long timeout_us)
+{
+	struct timespec deadline;
+
+	__fastq_deadline(&deadline, timeout_us);
+
+	return __FastQReserveWait(from, to, size, &deadline);
+}
+
+/**
+ *  FastQTryReserve - 申请发送节点（队列满时直接返回 NULL）
+ */
+void *
+FastQTryReserve(unsigned int from, unsigned int to, size_t size)
+{
+	struct FastQRing *ring = __fastq_tx_ring(from, to);
+
+	struct FastQRing *next;
+	void *msg = __FastQReserve(ring, size);
+
+	if (!msg && (next = __fastq_ring_grow(ring))) {
+		ring = next;
+		msg = __FastQReserve(ring, size);
+	}
+	if (!msg) {
+		__fastq_full_drop(ring, FASTQ_PRIO_NORMAL, 1);
+	}
+	return msg;
+}
+
+/**
+ *  FastQCommit - 发送 FastQReserve/FastQTryReserve 申请的节点
+ */
+bool
+FastQCommit(unsigned int from, unsigned int to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode, size_t size)
+{
+	struct FastQRing *ring = __atomic_load_n(&_AllModulesRings[to]._ring[from], __ATOMIC_RELAXED);
+	if(unlikely(!ring)) {
+		assert(0 && "Commit without reserve.");
+		return false;
+	}
+	if (unlikely(!__fastq_hdr_fits(msgType, msgCode, msgSubCode))) {
+		return false;
+	}
+
+	__FastQCommit(ring, msgType, msgCode, msgSubCode, size);
+
+	__fastq_ring_notify(ring);
+
+	return true;
+}
+
+/**
+ *  __fastq_bcast_readers - 将 mod_set 转换为广播队列的接收者掩码，没有读者的模块创建读者
+ */
+static uint64_t
+__fastq_bcast_readers(struct FastQBcastRing *bcast, const mod_set *to)
+{
+	uint64_t mask = 0;
+	unsigned long bits, dst;
+	unsigned int i, idx;
+
+	for (i = 0; i < sizeof(mod_set) / sizeof(__mod_mask); i++) {
+		bits = __MOD(to)[i];
+		while (bits) {
+			dst = i * __NMOD + __builtin_ctzl(bits);
+			bits &= bits - 1;
+
+			if (unlikely(dst == 0 || dst > FASTQ_ID_MAX) ||
+				!__atomic_load_n(&_AllModulesRings[dst].already_register, __ATOMIC_RELAXED)) {
+				continue;
+			}
+			idx = __atomic_load_n(&bcast->_reader_of[dst], __ATOMIC_RELAXED);
+			if (unlikely(!idx) && !(idx = __fastq_bcast_add_reader(bcast, dst))) {
+				continue;
+			}
+			mask |= 1UL << (idx - 1);
+		}
+	}
+	return mask;
+}
+
+/**
+ *  __fastq_bcast_slow - 覆盖位置 t 的节点之前需要等待的读者
+ *
+ *  只需等待 被覆盖消息 的接收者读过该消息，缓存的读位置不够时才读取读者的 _cursor；
+ *  调用者持有源模块的 _rcu，读到的读者在此期间不会被释放，已删除的读者不再等待
+ *
+ *  return 还没有读过被覆盖消息的一个读者，节点可以覆盖时返回 NULL
+ */
+static inline struct FastQBcastReader *
+__fastq_bcast_slow(struct FastQBcastRing *bcast, unsigned int t)
+{
+	struct fastq_bcast_slot *slot = __fastq_bcast_slot(bcast, t);
+	const unsigned int old = t - (bcast->_size + 1);    //被覆盖消息的位置
+	uint64_t wait = slot->mask & __atomic_load_n(&bcast->_live, __ATOMIC_ACQUIRE);
+	struct FastQBcastReader *reader;
+	unsigned int i;
+
+	while (wait) {
+		i = __builtin_ctzll(wait);
+		wait &= wait - 1;
+
+		if ((int)(bcast->_cursor_cache[i] - old) > 0) {
+			continue;
+		}
+		reader = __atomic_load_n(&bcast->_readers[i], __ATOMIC_ACQUIRE);
+		if (unlikely(!reader)) {
+			continue;
+		}
+		bcast->_cursor_cache[i] = __atomic_load_n(&reader->_cursor, __ATOMIC_ACQUIRE);
+		if ((int)(bcast->_cursor_cache[i] - old) <= 0) {
+			return reader;
+		}
+	}
+	return NULL;
+}
+
+/**
+ *  __FastQBroadcastWait - 广播消息，广播队列满时按 __fastq_backoff 等待最慢的读者，直到 deadline
+ *
+ *  消息体只拷贝一次，所有接收模块直接从广播队列中读取
+ */
+static bool
+__FastQBroadcastWait(unsigned int from, const mod_set *to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size, const struct timespec *deadline)
+{
+	assert(to && "NULL pointer error.");
+
+	if (unlikely(from <= 0 || from > FASTQ_ID_MAX) ) {
+		assert(0 && "Try to broadcast from not exist MODULE.\n");
+		return false;
+	}
+
+	struct FastQModule *this_module = &_AllModulesRings[from];
+
+	if (unlikely(!__atomic_load_n(&this_module->already_register, __ATOMIC_RELAXED))) {
+		return false;
+	}
+	if (unlikely(!__fastq_hdr_fits(msgType, msgCode, msgSubCode))) {
+		return false;
+	}
+	/* 广播队列 的节点按注册时的 msgSize 分配 */
+	if (unlikely(size > this_module->msg_size)) {
+		return false;
+	}
+
+	/* 广播队列 和 读者 在源模块的读者退出之后才释放，见 __fastq_bcast_destroy */
+	__fastq_rcu_enter(&this_module->_rcu);
+
+	struct FastQBcastRing *bcast = __atomic_load_n(&this_module->_bcast, __ATOMIC_ACQUIRE);
+	struct FastQBcastRing *expect = NULL;
+
+	if (unlikely(!bcast)) {
+		bcast = __fastq_bcast_create(this_module);
+		if (!__atomic_compare_exchange_n(&this_module->_bcast, &expect, bcast, 0,
+				__ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+			/* 其他线程已经创建 */
+			__fastq_bcast_put(bcast);
+			bcast = expect;
+		}
+	}
+
+	uint64_t mask = __fastq_bcast_readers(bcast, to);
+	if (unlikely(!mask)) {
+		__fastq_rcu_read_unlock(&this_module->_rcu);
+		return false;
+	}
+
+	unsigned int t = bcast->_tail;
+	struct FastQBcastReader *slow;
+	unsigned int spins = 0;
+
+	/* 读者推进 _cursor 时唤醒，被删除的读者不再等待（等待有上限，之后重新检查） */
+	while ((slow = __fastq_bcast_slow(bcast, t))) {
+		if (!__fastq_backoff(&slow->_cursor, &slow->_full_wait, &spins, deadline)) {
+			__fastq_rcu_read_unlock(&this_module->_rcu);
+			return false;
+		}
+	}
+
+	struct fastq_bcast_slot *slot = __fastq_bcast_slot(bcast, t);
+
+	/* 先让读者知道节点正在被覆盖，再写入 */
+	__atomic_store_n(&slot->seq, t, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	__atomic_store_n(&slot->mask, mask, __ATOMIC_RELAXED);
+	__fastq_ring_fill((char *)slot + FASTQ_BCAST_SLOT_SIZE,
+			msgType, msgCode, msgSubCode, msg, size);
+
+	__atomic_store_n(&slot->seq, t + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&bcast->_tail, t + 1, __ATOMIC_RELEASE);
+
+	/* 与 __fastq_bcast_rearm 配对，见 __fastq_ring_notify */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	/* 读者追上队尾之后只通知一次，FASTQ_MODULE_F_POLL_ONLY 的接收者自己轮询 */
+	while (mask) {
+		struct FastQBcastReader *reader = __atomic_load_n(
+				&bcast->_readers[__builtin_ctzll(mask)], __ATOMIC_ACQUIRE);
+
+		mask &= mask - 1;
+		if (unlikely(!reader)) {
+			/* 读者已被删除 */
+			continue;
+		}
+
+		struct FastQModule *pmodule = &_AllModulesRings[reader->dst];
+
+		if (pmodule->flags & FASTQ_MODULE_F_POLL_ONLY) {
+			continue;
+		}
+		if (pmodule->flags & FASTQ_MODULE_F_BUSY_POLL) {
+			__fastq_module_notify(pmodule);
+			continue;
+		}
+		if (__atomic_load_n(&reader->_armed, __ATOMIC_RELAXED) &&
+			__atomic_exchange_n(&reader->_armed, 0, __ATOMIC_ACQUIRE)) {
+			__fastq_module_ready(pmodule, from);
+		}
+	}
+	__fastq_rcu_read_unlock(&this_module->_rcu);
+
+	return true;
+}
+
+/**
+ *  FastQBroadcast - 广播消息（轮询直至成功发送）
+ */
+bool
+FastQBroadcast(unsigned int from, const mod_set *to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size)
+{
+	return __FastQBroadcastWait(from, to, msgType, msgCode, msgSubCode, msg, size, NULL);
+}
+
+/**
+ *  FastQBroadcastTimed - 广播消息（广播队列满时最多等待 timeout_us 微秒）
+ */
+bool
+FastQBroadcastTimed(unsigned int from, const mod_set *to, unsigned long msgType,
+				unsigned long msgCode, unsigned long msgSubCode,
+				const void *msg, size_t size, unsigned long timeout_us)
+{
+	struct timespec deadline;
+
+	__fastq_deadline(&deadline, timeout_us);
+
+	return __FastQBroadcastWait(from, to, msgType, msgCode, msgSubCode, msg, size, &deadline);
+}
+
+/**
+ *  __fastq_ow_recv - 覆盖队列 消费者: 读取队首消息
+ *
+ *  生产者随时可能覆盖队首节点，不能零拷贝：先拷贝到私有节点，再 CAS _head 取走这条消息，
+ *  CAS 成功说明拷贝期间节点没有被覆盖，除非 _head 被生产者推进了一整圈 (_ow_gen)；
+ *  claim 为 false 时只查看不出队 (FastQPeek)，位置记在 _head_next
+ *
+ *  return 读到的消息数 0/1
+ */
+static unsigned int
+__fastq_ow_recv(struct FastQRing *ring, struct FastQRecvMsg *msg, bool claim)
+{
+	char *copy = &ring->_ring_data[(ring->_size + 1) * ring->_msg_size];
+	struct fastq_node_hdr *hdr = (struct fastq_node_hdr *)copy;
+	unsigned long gen;
+	unsigned int h;
+
+	for (;;) {
+		gen = __atomic_load_n(&ring->_ow_gen, __ATOMIC_SEQ_CST);
+		h = __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE);
+		if (!__fastq_ring_count(ring, h, 1)) {
+			return 0;
+		}
+
+		memcpy(copy, &ring->_ring_data[h * ring->_msg_size], ring->_msg_size);
+
+		if (claim) {
+			if (!__atomic_compare_exchange_n(&ring->_head, &h, (h + 1) & ring->_size, 0,
+					__ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+				continue;   /* 已被覆盖 */
+			}
+		} else {
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&ring->_head, __ATOMIC_RELAXED) != h) {
+				continue;
+			}
+		}
+		if (likely(__atomic_load_n(&ring->_ow_gen, __ATOMIC_SEQ_CST) - gen <= ring->_size)) {
+			break;
+		}
+
+		/* 拷贝不可信，已经取走的消息当作已出队丢弃 */
+		if (claim) {
+			__fastq_stat_add(ring->nr_dequeue, 1);
+		}
+	}
 
-		注册过程：假设模块ID分别为 A=1, B=2, C=3
+	ring->_head_next = h;
 
-					rxset       txset           表明
-				A(1)    1100        0000    A可能从B(2)C(3)接收，不接收任何数据
-				B(2)    0000        0010    B不接受任何数据，可能向A(1)发送
-				C(3)    0000        0010    C不接受任何数据，可能向A(1)发送
-		 那么创建的 底层数据结构将会是
+	msg->size = min(hdr->size, __fastq_ring_payload_max(ring));
+	msg->type = hdr->type;
+	msg->code = hdr->code;
+	msg->subcode = hdr->subcode;
+	msg->msg = copy + FASTQ_NODE_HDR_SIZE;
 
-						+---+
-						|   |
-						| A |
-						|   |
-					  /`+---+ \`
-					 /         \
-					/           \
-				   /             \
-				  /               \
-				 /                 \
-			 +---+                 +---+
-			 |   |                 |   |
-			 | B |                 | C |
-			 |   |                 |   |
-			 +---+                 +---+
-	*/
-	for (i = 1; i <= FASTQ_ID_MAX; i++) {
+	return 1;
+}
+
+/**
+ *  __FastQRecvBurst - 公共批量接收函数
+ *
+ *  不拷贝消息体，msgs[].msg 直接指向 ring 中的节点，调用 __FastQRecvBurstDone
+ *  之前节点不会被发送方覆盖
+ *
+ *  return 可读取的消息数（不超过 max ）
+ */
+static unsigned int
+__FastQRecvBurst(struct FastQRing *ring, struct FastQRecvMsg *msgs,
+		unsigned int max)
+{
+	unsigned int h = ring->_head;
+	unsigned int n;
+	char *d;
+
+	if (__fastq_is_ow(ring)) {
+		return max ? __fastq_ow_recv(ring, msgs, true) : 0;
+	}
+
+	for (n = 0; n < max; n++) {
+		d = __fastq_ring_next(ring, &h);
+		if (!d) {
+			break;
+		}
+
+		struct fastq_node_hdr *hdr = (struct fastq_node_hdr *)d;
+
+		msgs[n].size = hdr->size;
+		msgs[n].type = hdr->type;
+		msgs[n].code = hdr->code;
+		msgs[n].subcode = hdr->subcode;
+		msgs[n].msg = d + FASTQ_NODE_HDR_SIZE;
+	}
+	ring->_head_next = h;
+
+	return n;
+}
+
+/**
+ *  __fastq_futex_wake - 消费者: 推进 *word 之后唤醒 __fastq_backoff 中等待的发送者
+ *
+ *  与 __fastq_backoff 配对：生产者 置等待标志 -> 全屏障 -> futex 比较位置，
+ *  消费者 写位置 -> 全屏障 -> 读等待标志，两边至少有一方看到对方的写
+ */
+static inline void
+__fastq_futex_wake(volatile unsigned int *word, volatile int *waiting)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (unlikely(__atomic_load_n(waiting, __ATOMIC_RELAXED))) {
+		__atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+		syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+	}
+}
+
+/**
+ *  __fastq_head_wake - 消费者: 移动 _head 之后唤醒等待空闲节点的发送者
+ */
+static inline void
+__fastq_head_wake(struct FastQRing *ring)
+{
+	__fastq_futex_wake(&ring->_head, &ring->_full_wait);
+}
+
+/**
+ *  __fastq_cursor_wake - 广播读者: 移动 _cursor 之后唤醒等待该读者的广播者
+ */
+static inline void
+__fastq_cursor_wake(struct FastQBcastReader *reader)
+{
+	__fastq_futex_wake(&reader->_cursor, &reader->_full_wait);
+}
+
+/**
+ *  __FastQRecvBurstDone - 归还 __FastQRecvBurst 读取的 n 个节点，只更新一次 _head
+ */
+static void
+__FastQRecvBurstDone(struct FastQRing *ring, unsigned int _unused n)
+{
+	//统计功能
+	__fastq_stat_add(ring->nr_dequeue, n);
+
+	/* 覆盖队列 在 __fastq_ow_recv 中已经 CAS 了 _head */
+	if (!__fastq_is_ow(ring)) {
+		__atomic_store_n(&ring->_head, ring->_head_next, __ATOMIC_RELEASE);
+	}
+
+	/* 有发送者在等待空闲节点 */
+	__fastq_head_wake(ring);
+}
+
+/**
+ *  __fastq_ring_migrate - 消费者: 旧队列已读空并且已被替换时，切换到新队列并释放旧队列
+ *
+ *  return 新队列，旧队列还有消息或没有被替换时返回 NULL
+ */
+static struct FastQRing *
+__fastq_ring_migrate(struct FastQRing *ring)
+{
+	struct FastQRing *next = __atomic_load_n(&ring->_next, __ATOMIC_ACQUIRE);
+	struct FastQModule *pmodule = &_AllModulesRings[ring->dst];
+
+	if (likely(!next)) {
+		return NULL;
+	}
+
+	/* 看到 _next 之后再检查一次，生产者替换前的最后一条消息一定可见 */
+	if (__fastq_ring_count(ring, ring->_head, 1) != 0) {
+		return NULL;
+	}
+
+	fastq_log("Migrate ring : src(%lu)->dst(%lu) ringsize(%d)->(%d).\n",
+		ring->src, ring->dst, ring->_size + 1, next->_size + 1);
+
+	//统计功能
+	__fastq_stat_add(next->nr_dequeue, ring->nr_dequeue);
+
+	if (__atomic_load_n(&ring->_rx->ring, __ATOMIC_RELAXED) == ring) {
+		__atomic_store_n(&ring->_rx->ring, next, __ATOMIC_RELEASE);
+	}
+
+	/**
+	 *  配置线程持有写锁时可能正在标记旧队列，见 __fastq_ring_mark；
+	 *  统计 和 FastQDump 可能还在读旧队列，等 _rcu 的读者退出再释放
+	 */
+	pthread_rwlock_rdlock(&pmodule->rx.rwlock);
+	__fastq_call_rcu(&pmodule->_rcu, &ring->rcu, __fastq_ring_release);
+	pthread_rwlock_unlock(&pmodule->rx.rwlock);
+
+	return next;
+}
+
+/**
+ *  __fastq_ring_rx - 消费者当前读取的队列
+ *
+ *  扩容后旧队列读空之前，消费者仍然读取旧队列
+ */
+static inline struct FastQRing *
+__fastq_ring_rx(struct FastQRing *ring)
+{
+	struct FastQRing *rx = __atomic_load_n(&ring->_rx->ring, __ATOMIC_ACQUIRE);
+
+	return rx ? rx : ring;
+}
+
+/**
+ *  接收处理函数，逐条拷贝、逐条零拷贝 或 批量
+ */
+enum {
+	FASTQ_RECV_COPY,
+	FASTQ_RECV_ZEROCOPY,
+	FASTQ_RECV_BURST,
+};
+
+struct fastq_recv_handler {
+	int mode;
+	union {
+		fq_msg_handler_t msg_handler;
+		fq_msg_zc_handler_t zc_handler;
+		fq_burst_handler_t burst_handler;
+	};
+};
+
+/**
+ *  FASTQ_RECV_BUF_SIZE - FastQRecv 拷贝消息使用的栈缓冲大小，更大的消息临时申请内存
+ */
+#define FASTQ_RECV_BUF_SIZE 4096
+
+/**
+ *  __fastq_recv_call - 对 n 条消息调用应用层接收函数
+ */
+static void
+__fastq_recv_call(const struct fastq_recv_handler *handler, unsigned long src,
+		unsigned long dst, const struct FastQRecvMsg *msgs, unsigned int n)
+{
+	char __attribute__((aligned(64))) addr[FASTQ_RECV_BUF_SIZE];
+	unsigned int i;
+	void *buf;
+
+	switch (handler->mode) {
+	case FASTQ_RECV_BURST:
+		/* 调用应用层 批量接收函数 */
+		handler->burst_handler(src, dst, msgs, n);
+		break;
+	case FASTQ_RECV_ZEROCOPY:
+		for (i = 0; i < n; i++) {
+			handler->zc_handler(src, dst,
+				msgs[i].type, msgs[i].code, msgs[i].subcode,
+				msgs[i].msg, msgs[i].size);
+		}
+		break;
+	default:
+		/* 拷贝后调用应用层 接收函数 */
+		for (i = 0; i < n; i++) {
+			buf = likely(msgs[i].size <= sizeof(addr)) ? addr : FastQMalloc(msgs[i].size);
+			assert(buf && "Malloc error.");
+			memcpy(buf, msgs[i].msg, msgs[i].size);
+			handler->msg_handler(src, dst,
+				msgs[i].type, msgs[i].code, msgs[i].subcode,
+				buf, msgs[i].size);
+			if (unlikely(buf != addr)) {
+				FastQFree(buf);
+			}
+		}
+		break;
+	}
+}
+
+/**
+ *  __fastq_ring_deliver - 从 ring 中接收最多 max 条消息并调用应用层接收函数
+ *
+ *  应用层接收函数返回后才归还节点，零拷贝和批量模式直接访问 ring 中的节点
+ *
+ *  return 处理的消息数
+ */
+static unsigned int
+__fastq_ring_deliver(struct FastQRing *ring, unsigned int max,
+		const struct fastq_recv_handler *handler)
+{
+	struct FastQRecvMsg msgs[FASTQ_BURST_MAX];
+	unsigned int n;
 
+	n = __FastQRecvBurst(ring, msgs, min(max, FASTQ_BURST_MAX));
+	if (unlikely(!n)) {
+		return 0;
+	}
+
+	__fastq_recv_call(handler, ring->src, ring->dst, msgs, n);
+
+	__FastQRecvBurstDone(ring, n);
+	return n;
+}
+
+/**
+ *  __fastq_prio_drain - 处理发往该模块的所有高优先级消息
+ *
+ *  高优先级消息和普通消息共用就绪位，之后读该队列时不会再看到这些消息；
+ *  多消费者模式 下只处理本线程持有或能抢到的队列；
+ *  调用者持有 pmodule->_rcu，见 __fastq_recv_wait
+ *
+ *  return 处理的高优先级消息数
+ */
+static unsigned long
+__fastq_prio_drain(struct FastQModule *pmodule, struct FastQRing *curr,
+		const struct fastq_recv_handler *handler)
+{
+	struct fastq_id_list *srcs;
+	struct FastQRing *ring, *hi;
+	unsigned long done = 0;
+	unsigned int i, n;
+	int owner;
+
+	srcs = __atomic_load_n(&pmodule->_rx_list, __ATOMIC_ACQUIRE);
+
+	for (i = 0; srcs && i < srcs->nr; i++) {
+		ring = __atomic_load_n(&pmodule->_ring[srcs->id[i]], __ATOMIC_RELAXED);
+		if (!ring) {
+			continue;
+		}
+		hi = __atomic_load_n(&ring->_prio, __ATOMIC_ACQUIRE);
+		if (!hi) {
+			continue;
+		}
+
+		owner = 0;
+		if (ring != curr && __fastq_is_mc(ring) &&
+			!__atomic_compare_exchange_n(&ring->_owner, &owner, 1, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			continue;
+		}
+
+		while ((n = __fastq_ring_deliver(hi, FASTQ_BURST_MAX, handler))) {
+			done += n;
+			__atomic_sub_fetch(&pmodule->_prio_pending, n, __ATOMIC_RELAXED);
+		}
+
+		if (ring != curr && __fastq_is_mc(ring)) {
+			__atomic_store_n(&ring->_owner, 0, __ATOMIC_RELEASE);
+		}
+	}
+
+	return done;
+}
+
+/**
+ *  __fastq_ring_drain - 接收 ring 中的消息，直到读空或者处理了 budget 条
+ *
+ *  每批消息之前检查该模块是否有高优先级消息，有则先处理所有队列的高优先级消息；
+ *  旧队列读空后切换到扩容后的新队列，*pring 更新为当前读取的队列
+ *
+ *  return 处理的消息数
+ */
+static eventfd_t
+__fastq_ring_drain(struct FastQRing **pring, const struct fastq_recv_handler *handler,
+		eventfd_t budget)
+{
+	struct FastQRing *ring = *pring, *next;
+	struct FastQModule *pmodule = &_AllModulesRings[ring->dst];
+	eventfd_t done = 0;
+	unsigned int n;
+
+	while (done < budget) {
 		/**
-		 *  若模块自己给自己发送，创建环形队列将不在这里创建，而是在发送第一条消息时创建
-		 *  2021年5月11日 荣涛
+		 *  动态删除模块时，可能导致 src/dst 失效
 		 */
-		if(i == module_id) continue;
+		if (unlikely(ring->src > FASTQ_ID_MAX) ||
+			unlikely(ring->dst > FASTQ_ID_MAX)) {
+			break;
+		}
 
-		struct FastQModule *peer_module = &_AllModulesRings[i];
+		if (unlikely(__atomic_load_n(&pmodule->_prio_pending, __ATOMIC_RELAXED) > 0)) {
+			done += __fastq_prio_drain(pmodule, ring, handler);
+		}
 
-		if(!__atomic_load_n(&peer_module->already_register, __ATOMIC_RELAXED)) {
+		n = __fastq_ring_deliver(ring, (unsigned int)min(budget - done, FASTQ_BURST_MAX), handler);
+		if (unlikely(!n)) {
+			/* 旧队列已读空，其余消息在扩容后的新队列中 */
+			if ((next = __fastq_ring_migrate(ring))) {
+				ring = next;
 				continue;
+			}
+			break;
 		}
+		done += n;
+	}
 
-		//任意一个模块标记了可能发送或者接收的模块，都将创建队列
-		if (MOD_ISSET(i, &this_module->rx.set) ||
-		   MOD_ISSET(module_id, &peer_module->tx.set)) {
+	*pring = ring;
+	return done;
+}
 
-				MOD_SET(i, &this_module->rx.set);
-				MOD_SET(module_id, &peer_module->tx.set);
+/**
+ *  __fastq_ring_ready - 消费者: 队首是否有已发布的消息（包括高优先级队列和扩容后的新队列）
+ */
+static inline bool
+__fastq_ring_ready(struct FastQRing *ring)
+{
+	struct FastQRing *hi = __atomic_load_n(&ring->_prio, __ATOMIC_ACQUIRE);
+	unsigned int h;
 
-				__fastq_create_ring(this_module, i, module_id);
+	h = __atomic_load_n(&ring->_head, __ATOMIC_RELAXED);
+	if (__fastq_ring_next(ring, &h)) {
+		return true;
+	}
+	if (hi) {
+		h = __atomic_load_n(&hi->_head, __ATOMIC_RELAXED);
+		if (__fastq_ring_next(hi, &h)) {
+			return true;
+		}
+	}
+	return __atomic_load_n(&ring->_next, __ATOMIC_RELAXED) != NULL;
+}
+
+/**
+ *  __fastq_ring_rearm - 消费者: 读空队列后重新使能 _armed
+ *
+ *  与 __fastq_ring_notify 配对：置 _armed -> 全屏障 -> 再检查一次队列，
+ *  检查之后发布的消息一定会置就绪位
+ *
+ *  return 检查时又有了消息，并且本线程收回了 _armed（需要继续读）时返回 true
+ */
+static inline bool
+__fastq_ring_rearm(struct FastQRing *ring)
+{
+	__atomic_store_n(&ring->_armed, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (likely(!__fastq_ring_ready(ring))) {
+		return false;
+	}
+	/* 收回失败说明生产者已经看到 _armed 并置了就绪位，由下一次扫描处理 */
+	return __atomic_exchange_n(&ring->_armed, 0, __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ *  __fastq_ring_dispatch - 接收 ring 中的消息直到读空，然后重新使能 _armed
+ *
+ *  处理了 budget 条还没有读空时不使能 _armed，而是放回就绪位，下一次继续处理
+ *
+ *  return 处理的消息数
+ */
+static eventfd_t
+__fastq_ring_dispatch(struct FastQRing *ring, const struct fastq_recv_handler *handler,
+		eventfd_t budget)
+{
+	eventfd_t done = 0;
+
+	do {
+		done += __fastq_ring_drain(&ring, handler, budget - done);
+		if (done >= budget) {
+			/* 预算用完，还有消息时放回就绪位 */
+			if (__fastq_ring_ready(ring) || __fastq_ring_rearm(ring)) {
+				__fastq_ready_mark(&_AllModulesRings[ring->dst], ring->src);
+			}
+			break;
+		}
+	} while (__fastq_ring_rearm(ring));
+
+	return done;
+}
+
+/**
+ *  __fastq_ring_dispatch_shared - 多消费者模式 接收 ring 中的消息
+ *
+ *  取走就绪位的线程读空队列并处理对应的消息，_armed 重新使能之前其他线程取不到这个队列，
+ *  不同源模块的队列可以被不同线程并行处理，同一个源模块的消息仍然保序；
+ *  _owner 与 __fastq_prio_drain 互斥
+ *
+ *  最多处理 budget 条，返回实际处理的条数
+ */
+static eventfd_t
+__fastq_ring_dispatch_shared(struct FastQModule *pmodule, struct FastQRing *ring,
+		const struct fastq_recv_handler *handler, eventfd_t budget)
+{
+	eventfd_t done = 0;
+	int owner = 0;
+
+	if (__atomic_compare_exchange_n(&ring->_owner, &owner, 1, 0,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+
+		done = __fastq_ring_dispatch(ring, handler, budget);
+
+		__atomic_store_n(&ring->_owner, 0, __ATOMIC_RELEASE);
+	} else {
+		/* 其他线程正在处理高优先级消息，放回就绪位 */
+		__fastq_ready_mark(pmodule, ring->src);
+		__relax();
+	}
+	return done;
+}
+
+/**
+ *  __fastq_bcast_dispatch - 从广播队列中接收最多 cnt 条发给自己的消息并调用应用层接收函数
+ *
+ *  跳过不是发给自己的节点，落后超过一圈时直接跳到最旧的未覆盖节点，追上队尾时返回
+ *
+ *  return 处理的消息数
+ */
+static eventfd_t
+__fastq_bcast_dispatch(struct FastQBcastReader *reader, eventfd_t cnt,
+		const struct fastq_recv_handler *handler)
+{
+	struct FastQBcastRing *bcast = reader->bcast;
+	struct FastQRecvMsg msgs[FASTQ_BURST_MAX];
+	const unsigned int cap = bcast->_size + 1;
+	const uint64_t bit = 1UL << reader->idx;
+	unsigned int c = reader->_cursor;
+	unsigned int n, t, max;
+	struct fastq_bcast_slot *slot;
+	struct fastq_node_hdr *hdr;
+	eventfd_t done = 0;
+	uint32_t seq;
+
+	while (done < cnt) {
+		t = __atomic_load_n(&bcast->_tail, __ATOMIC_ACQUIRE);
+		if (t - c > cap) {
+			/* 更早的节点都已被覆盖，一定不是发给自己的 */
+			c = t - cap;
+		}
+
+		max = min(cnt - done, FASTQ_BURST_MAX);
+		for (n = 0; n < max && c != t; c++) {
+			slot = __fastq_bcast_slot(bcast, c);
+
+			seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+			if (seq != c + 1) {
+				continue;
+			}
+			if (!(__atomic_load_n(&slot->mask, __ATOMIC_RELAXED) & bit)) {
+				continue;
+			}
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+				continue;
+			}
+
+			/* 发给自己的节点在 _cursor 越过之前不会被覆盖 */
+			hdr = (struct fastq_node_hdr *)((char *)slot + FASTQ_BCAST_SLOT_SIZE);
+
+			msgs[n].size = hdr->size;
+			msgs[n].type = hdr->type;
+			msgs[n].code = hdr->code;
+			msgs[n].subcode = hdr->subcode;
+			msgs[n].msg = (char *)hdr + FASTQ_NODE_HDR_SIZE;
+			n++;
+		}
+
+		if (!n) {
+			/* 已经追上队尾 */
+			if (c != reader->_cursor) {
+				__atomic_store_n(&reader->_cursor, c, __ATOMIC_RELEASE);
+				__fastq_cursor_wake(reader);
+			}
+			break;
+		}
+
+		__fastq_recv_call(handler, bcast->src, reader->dst, msgs, n);
+
+		__atomic_store_n(&reader->_cursor, c, __ATOMIC_RELEASE);
+		__fastq_cursor_wake(reader);
+		done += n;
+	}
+	return done;
+}
+
+/**
+ *  __fastq_bcast_rearm - 读者: 追上队尾后重新使能 _armed，见 __fastq_ring_rearm
+ *
+ *  return 检查时又有了消息，并且本线程收回了 _armed（需要继续读）时返回 true
+ */
+static inline bool
+__fastq_bcast_rearm(struct FastQBcastReader *reader)
+{
+	__atomic_store_n(&reader->_armed, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (likely(__atomic_load_n(&reader->_cursor, __ATOMIC_RELAXED) ==
+			__atomic_load_n(&reader->bcast->_tail, __ATOMIC_ACQUIRE))) {
+		return false;
+	}
+	return __atomic_exchange_n(&reader->_armed, 0, __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ *  __fastq_bcast_recv - 接收广播队列中发给自己的消息直到追上队尾，然后重新使能 _armed
+ *
+ *  处理了 budget 条还没有追上时放回就绪位，见 __fastq_ring_dispatch
+ *
+ *  return 处理的消息数
+ */
+static eventfd_t
+__fastq_bcast_recv(struct FastQModule *pmodule, struct FastQBcastReader *reader,
+		const struct fastq_recv_handler *handler, eventfd_t budget)
+{
+	eventfd_t done = 0;
+
+	do {
+		done += __fastq_bcast_dispatch(reader, budget - done, handler);
+		if (done >= budget) {
+			if (reader->_cursor != __atomic_load_n(&reader->bcast->_tail, __ATOMIC_ACQUIRE) ||
+				__fastq_bcast_rearm(reader)) {
+				__fastq_ready_mark(pmodule, reader->bcast->src);
+			}
+			break;
 		}
-		if (!__atomic_load_n(&peer_module->_ring[module_id], __ATOMIC_RELAXED)) {
+	} while (__fastq_bcast_rearm(reader));
 
-				if(MOD_ISSET(i, &this_module->tx.set) ||
-				   MOD_ISSET(module_id, &peer_module->rx.set)) {
-
-				MOD_SET(i, &this_module->tx.set);
-				MOD_SET(module_id, &peer_module->rx.set);
+	return done;
+}
 
-				__fastq_create_ring(peer_module, module_id, i);
+/**
+ *  __fastq_bcast_reader_of - 读者列表 readers 中 源模块 src 的读者
+ *
+ *  调用者持有接收模块的 _rcu；读者只通过接收模块自己的列表查找，
+ *  源模块的广播队列被删除后，读者持有的引用保证它在读者释放之前有效
+ */
+static inline struct FastQBcastReader *
+__fastq_bcast_reader_of(const struct fastq_id_list *readers, unsigned long src)
+{
+	struct FastQBcastReader *reader;
+	unsigned int i;
 
-				//通知对方即将发送消息，select 需要更新 readset
-				eventfd_write(peer_module->notify_new_enqueue_evt_fd, 1);
-				}
+	for (i = 0; readers && i < readers->nr; i++) {
+		reader = (struct FastQBcastReader *)readers->id[i];
+		if (reader->src == src) {
+			return reader;
 		}
 	}
+	return NULL;
+}
 
-	//已注册
-	__atomic_store_n(&this_module->status, MODULE_STATUS_REGISTED, __ATOMIC_RELEASE);
+/**
+ *  __fastq_ready_src - 处理取走就绪位的源模块 src：发往该模块的队列 和 广播队列
+ *
+ *  调用者持有 pmodule->_rcu，见 __fastq_recv_wait
+ *
+ *  return 处理的消息数
+ */
+static eventfd_t
+__fastq_ready_src(struct FastQModule *pmodule, unsigned long src,
+		const struct fastq_recv_handler *handler, eventfd_t budget)
+{
+	struct FastQRing *ring = __atomic_load_n(&pmodule->_ring[src], __ATOMIC_ACQUIRE);
+	struct FastQBcastReader *reader;
+	struct fastq_id_list *readers;
+	eventfd_t done = 0;
+
+	if (ring) {
+		ring = __fastq_ring_rx(ring);
+		done = __fastq_is_mc(ring) ?
+				__fastq_ring_dispatch_shared(pmodule, ring, handler, budget) :
+				__fastq_ring_dispatch(ring, handler, budget);
+	}
 
-	return;
+	/* 多消费者模式 不支持广播 */
+	if (!(pmodule->flags & FASTQ_MODULE_F_MULTI_CONSUMER) &&
+		unlikely(__atomic_load_n(&pmodule->_bcast_list, __ATOMIC_RELAXED))) {
+		readers = __atomic_load_n(&pmodule->_bcast_list, __ATOMIC_ACQUIRE);
+		if ((reader = __fastq_bcast_reader_of(readers, src))) {
+			if (done < budget) {
+				done += __fastq_bcast_recv(pmodule, reader, handler, budget - done);
+			} else {
+				/* 预算用完，广播消息下一次处理 */
+				__fastq_ready_mark(pmodule, src);
+			}
+		}
+	}
+	return done;
 }
 
-bool
-FastQAddSet(const unsigned long moduleID, const mod_set *rxset,
-	const mod_set *txset)
+/**
+ *  __fastq_ready_dispatch - 扫描就绪位图，处理最多 budget 条消息
+ *
+ *  只看置位的源模块 (ctz)，扫描代价与就绪的队列数成正比；
+ *  每一位由 fetch_and 取走，多消费者模式 下同一个队列只被一个线程取到；
+ *  预算用完时下一次从下一个字开始，budget 较小时不会饿死后面的源模块
+ *
+ *  return 处理的消息数
+ */
+static eventfd_t
+__fastq_ready_dispatch(struct FastQModule *pmodule, const struct fastq_recv_handler *handler,
+		eventfd_t budget)
 {
-	if (unlikely(!rxset && !txset)) {
-		return false;
+	const unsigned long start = __atomic_load_n(&pmodule->_ready_word, __ATOMIC_RELAXED);
+	unsigned long i, w = 0;
+	uint64_t bits, bit, old;
+	eventfd_t done = 0;
+
+	for (i = 0; i < FASTQ_READY_WORDS && done < budget; i++) {
+		w = (start + i) % FASTQ_READY_WORDS;
+
+		bits = __atomic_load_n(&pmodule->_ready[w], __ATOMIC_RELAXED);
+		while (bits && done < budget) {
+			bit = bits & -bits;
+			bits &= bits - 1;
+
+			old = __atomic_fetch_and(&pmodule->_ready[w], ~bit, __ATOMIC_ACQUIRE);
+			if (unlikely(!(old & bit))) {
+				/* 其他接收线程已经取走 */
+				continue;
+			}
+			done += __fastq_ready_src(pmodule, w * 64 + __builtin_ctzll(bit),
+					handler, budget - done);
+		}
 	}
-	if (moduleID <= 0 || moduleID > FASTQ_ID_MAX) {
-		return false;
+
+	if (done >= budget) {
+		__atomic_store_n(&pmodule->_ready_word, (w + 1) % FASTQ_READY_WORDS, __ATOMIC_RELAXED);
 	}
-	struct FastQModule *this_module = &_AllModulesRings[moduleID];
+	return done;
+}
 
-	if (!__atomic_load_n(&this_module->already_register, __ATOMIC_RELAXED)) {
+/**
+ *  __fastq_ready_pending - 就绪位图 是否非空
+ */
+static bool
+__fastq_ready_pending(struct FastQModule *pmodule)
+{
+	unsigned long w;
 
-		return false;
+	for (w = 0; w < FASTQ_READY_WORDS; w++) {
+		if (__atomic_load_n(&pmodule->_ready[w], __ATOMIC_RELAXED)) {
+			return true;
+		}
 	}
+	return false;
+}
 
-	//自旋获取修改权限
-	module_status_t should_be = MODULE_STATUS_OK;
-	while (!__atomic_compare_exchange_n(&this_module->status, &should_be,
-				MODULE_STATUS_MODIFY, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
-		__relax();
-		should_be = MODULE_STATUS_OK;
+/**
+ *  __fastq_poll_ring - 轮询接收一个队列，多消费者模式 下只处理本线程能抢到的队列
+ */
+static inline eventfd_t
+__fastq_poll_ring(struct FastQRing *ring, const struct fastq_recv_handler *handler,
+		eventfd_t budget)
+{
+	struct FastQRing *mc = ring;
+	eventfd_t done;
+	int owner = 0;
+
+	if (likely(!__fastq_is_mc(ring))) {
+		return __fastq_ring_drain(&ring, handler, budget);
+	}
+	if (!__atomic_compare_exchange_n(&mc->_owner, &owner, 1, 0,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		return 0;
 	}
+	done = __fastq_ring_drain(&ring, handler, budget);
+	__atomic_store_n(&mc->_owner, 0, __ATOMIC_RELEASE);
 
-	/**
-	 *  从这里开始, 将会修改 模块内容，模块状态为 `MODULE_STATUS_MODIFY`
-	 */
-	int i;
+	return done;
+}
 
-	//遍历
-	for (i = 1; i <= FASTQ_ID_MAX; i++) {
-		if (i == moduleID) continue;
+/**
+ *  __fastq_futex_wait - futex 后端 接收线程睡眠，直到生产者唤醒、超时 或 *_futex 不等于 seq
+ *
+ *  return 模块已被删除返回 -1，否则返回 0
+ */
+static long
+__fastq_futex_wait(struct FastQModule *pmodule, int seq, int timeout_ms)
+{
+	struct timespec ts, *pts = NULL;
 
-		struct FastQModule *peer_module = &_AllModulesRings[i];
+	if (timeout_ms >= 0) {
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+		pts = &ts;
+	}
+	syscall(SYS_futex, &pmodule->_futex, FUTEX_WAIT_PRIVATE, seq, pts, NULL, 0);
 
-		//目的模块必须存在
-		if (!__atomic_load_n(&peer_module->already_register, __ATOMIC_RELAXED)) {
-				continue;
-		}
+	return __atomic_load_n(&pmodule->already_register, __ATOMIC_RELAXED) ? 0 : -1;
+}
 
-		//接收
-		pthread_rwlock_wrlock(&this_module->rx.rwlock);
-		if (rxset && MOD_ISSET(i, rxset) && !MOD_ISSET(i, &this_module->rx.set)) {
-				MOD_SET(i, &this_module->rx.set);
-				pthread_rwlock_wrlock(&peer_module->tx.rwlock);
-				MOD_SET(moduleID, &peer_module->tx.set);
-				pthread_rwlock_unlock(&peer_module->tx.rwlock);
+/**
+ *  __fastq_poll_sweep - 忙轮询模式 轮询发往该模块的所有队列 和 广播队列，接收最多 budget 条消息
+ *
+ *  忙轮询的生产者不置就绪位，这里逐个检查 _rx_list 中的源模块 和 _bcast_list 中的读者；
+ *  预算用完时下一次从下一个队列开始，budget 较小时不会饿死后面的队列；
+ *  调用者持有 pmodule->_rcu，每次轮询不再修改读者计数，见 __fastq_recv_wait
+ *
+ *  return 处理的消息数
+ */
+static eventfd_t
+__fastq_poll_sweep(struct FastQModule *pmodule, const struct fastq_recv_handler *handler,
+		eventfd_t budget)
+{
+	struct FastQBcastReader *reader;
+	struct fastq_id_list *srcs;
+	struct FastQRing *ring;
+	unsigned int i, k = 0;
+	eventfd_t done = 0;
 
-				__fastq_create_ring(this_module, i, moduleID);
-		}
-		pthread_rwlock_unlock(&this_module->rx.rwlock);
+	srcs = __atomic_load_n(&pmodule->_rx_list, __ATOMIC_ACQUIRE);
 
-		//发送
-		pthread_rwlock_wrlock(&this_module->tx.rwlock);
-		if (txset && MOD_ISSET(i, txset) && !MOD_ISSET(i, &this_module->tx.set)) {
-				MOD_SET(i, &this_module->tx.set);
-				pthread_rwlock_wrlock(&peer_module->rx.rwlock);
-				MOD_SET(moduleID, &peer_module->rx.set);
-				pthread_rwlock_wrlock(&peer_module->rx.rwlock);
+	for (i = 0; srcs && i < srcs->nr && done < budget; i++) {
+		k = (pmodule->_poll_src + i) % srcs->nr;
 
-				__fastq_create_ring( peer_module, moduleID, i);
+		ring = __atomic_load_n(&pmodule->_ring[srcs->id[k]], __ATOMIC_RELAXED);
+		if (ring) {
+			done += __fastq_poll_ring(__fastq_ring_rx(ring), handler, budget - done);
 		}
-		pthread_rwlock_unlock(&this_module->tx.rwlock);
+	}
+	if (done >= budget) {
+		pmodule->_poll_src = k + 1;
 	}
 
-	__atomic_store_n(&this_module->status, MODULE_STATUS_OK, __ATOMIC_RELEASE);
+	srcs = __atomic_load_n(&pmodule->_bcast_list, __ATOMIC_ACQUIRE);
 
-	return true;
+	for (i = 0; srcs && i < srcs->nr && done < budget; i++) {
+		reader = (struct FastQBcastReader *)srcs->id[i];
+		done += __fastq_bcast_dispatch(reader, budget - done, handler);
+	}
+
+	return done;
 }
 
-bool
-FastQDeleteModule(const unsigned long moduleID)
+/**
+ *  __fastq_poll_pending - 忙轮询模式 是否还有没有接收的消息，调用者持有 pmodule->_rcu
+ */
+static bool
+__fastq_poll_pending(struct FastQModule *pmodule)
 {
-	int i;
+	struct FastQBcastReader *reader;
+	struct fastq_id_list *srcs;
+	struct FastQRing *ring;
+	bool pending = false;
+	unsigned int i;
 
-	if ((moduleID <= 0 || moduleID > FASTQ_ID_MAX) ) {
-		return false;
+	if (__atomic_load_n(&pmodule->_prio_pending, __ATOMIC_RELAXED) > 0) {
+		return true;
 	}
 
-	struct FastQModule *this_module = &_AllModulesRings[moduleID];
-
-	pthread_rwlock_wrlock(&_AllModulesRingsLock);
+	srcs = __atomic_load_n(&pmodule->_rx_list, __ATOMIC_ACQUIRE);
 
-	//检查模块是否已经注册
-	if(!__atomic_load_n(&this_module->already_register, __ATOMIC_RELAXED)) {
-		pthread_rwlock_unlock(&_AllModulesRingsLock);
-		return true; //不存在也是删除成功吧
+	for (i = 0; srcs && i < srcs->nr && !pending; i++) {
+		ring = __atomic_load_n(&pmodule->_ring[srcs->id[i]], __ATOMIC_RELAXED);
+		pending = ring && __fastq_ring_ready(__fastq_ring_rx(ring));
 	}
 
-	for (i = 1; i <= FASTQ_ID_MAX; i++) {
+	srcs = __atomic_load_n(&pmodule->_bcast_list, __ATOMIC_ACQUIRE);
 
-		if (i == moduleID) continue;
+	for (i = 0; srcs && i < srcs->nr && !pending; i++) {
+		reader = (struct FastQBcastReader *)srcs->id[i];
+		pending = __atomic_load_n(&reader->_cursor, __ATOMIC_RELAXED) !=
+				__atomic_load_n(&reader->bcast->_tail, __ATOMIC_RELAXED);
+	}
 
-		struct FastQModule *peer_module = &_AllModulesRings[i];
+	return pending;
+}
 
-		if (!__atomic_load_n(&peer_module->already_register, __ATOMIC_RELAXED)) {
-				continue;
-		}
+/**
+ *  __fastq_recv_ready - 接收最多 budget 条已就绪的消息
+ *
+ *  忙轮询模式 逐个轮询队列，其余模块只处理就绪位图中置位的源模块
+ */
+static inline eventfd_t
+__fastq_recv_ready(struct FastQModule *pmodule, const struct fastq_recv_handler *handler,
+		eventfd_t budget)
+{
+	if (pmodule->flags & FASTQ_MODULE_F_BUSY_POLL) {
+		return __fastq_poll_sweep(pmodule, handler, budget);
+	}
+	return __fastq_ready_dispatch(pmodule, handler, budget);
+}
 
-		//接收
-		pthread_rwlock_wrlock(&this_module->rx.rwlock);
-		if (MOD_ISSET(i, &this_module->rx.set)) {
-				MOD_CLR(i, &this_module->rx.set);
-				__fastq_destroy_ring(this_module, i, moduleID);
-		}
-		pthread_rwlock_unlock(&this_module->rx.rwlock);
+/**
+ *  __fastq_recv_pending - 是否还有没有接收的消息，见 __fastq_recv_ready
+ *
+ *  多消费者模式 下其他线程已经取走的就绪位不算，由该线程处理完之后放回
+ */
+static inline bool
+__fastq_recv_pending(struct FastQModule *pmodule)
+{
+	if (pmodule->flags & FASTQ_MODULE_F_BUSY_POLL) {
+		return __fastq_poll_pending(pmodule);
+	}
+	return __fastq_ready_pending(pmodule);
+}
 
-		//发送
-		pthread_rwlock_wrlock(&this_module->tx.rwlock);
-		if (MOD_ISSET(i, &this_module->tx.set)) {
-				MOD_CLR(i, &this_module->tx.set);
-				__fastq_destroy_ring( peer_module, moduleID, i);
-		}
-		pthread_rwlock_unlock(&this_module->tx.rwlock);
+/**
+ *  __fastq_recv_sleep - 接收线程准备睡眠: 置 _sleeping 之后再检查一次
+ *
+ *  与 __fastq_module_notify 配对，检查之后发布的消息一定会敲门铃；
+ *  调用者持有 pmodule->_rcu
+ *
+ *  return 可以睡眠返回 true，还有消息时清除 _sleeping 并返回 false
+ */
+static bool
+__fastq_recv_sleep(struct FastQModule *pmodule)
+{
+	__atomic_store_n(&pmodule->_sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__fastq_recv_pending(pmodule)) {
+		__atomic_store_n(&pmodule->_sleeping, 0, __ATOMIC_RELAXED);
+		return false;
 	}
+	return true;
+}
 
-	//当设置了标志位，并且对应的 ring 为空
-	if (MOD_ISSET(0, &this_module->rx.set) &&
-		__atomic_load_n(&this_module->_ring[0], __ATOMIC_RELAXED)) {
-		/* 当源模块未初始化时又想向目的模块发送消息 */
-		__fastq_destroy_ring(this_module, 0, moduleID);
+/**
+ *  __fastq_recv_enter - 接收函数开始: 清除 _sleeping
+ *
+ *  _sleeping 已经被生产者（或 __fastq_recv_leave）清除，说明门铃被敲过，读空门铃，
+ *  外部事件循环等待的 fd 不再可读；多消费者模式 生产者不看 _sleeping，总是读空
+ */
+static inline void
+__fastq_recv_enter(struct FastQModule *pmodule)
+{
+	if (!__atomic_exchange_n(&pmodule->_sleeping, 0, __ATOMIC_ACQUIRE) ||
+		(pmodule->flags & FASTQ_MODULE_F_MULTI_CONSUMER)) {
+		pmodule->backend->ack(pmodule);
 	}
+}
 
-	FastQFree(this_module->_file);
-	FastQFree(this_module->_func);
+/**
+ *  __fastq_recv_leave - 接收函数返回前恢复 _sleeping
+ *
+ *  之后由外部事件循环等待 FastQGetFd，还有消息时敲一次门铃使其可读，
+ *  futex 后端 唤醒其他在等待的接收线程
+ */
+static void
+__fastq_recv_leave(struct FastQModule *pmodule)
+{
+	/* 模块已被删除 */
+	if (unlikely(!__atomic_load_n(&pmodule->already_register, __ATOMIC_RELAXED))) {
+		return;
+	}
+	__fastq_rcu_enter(&pmodule->_rcu);
+	if (!__fastq_recv_sleep(pmodule)) {
+		/* _sleeping 保持 0，下一次 __fastq_recv_enter 读空门铃 */
+		__fastq_module_kick(pmodule);
+	}
+	__fastq_rcu_read_unlock(&pmodule->_rcu);
+}
 
-	memset(&this_module->tx.set, 0x00, sizeof(mod_set));
-	memset(&this_module->rx.set, 0x00, sizeof(mod_set));
+/**
+ *  __fastq_doorbell_wait - 等待门铃最多 timeout_ms 毫秒，门铃响了则读空
+ *
+ *  return 模块已被删除 或 等待出错返回 -1，否则返回 0
+ */
+static long
+__fastq_doorbell_wait(struct FastQModule *pmodule, int seq, int timeout_ms)
+{
+	int nfds = 0;
 
-	if (__atomic_load_n(&this_module->name_attached, __ATOMIC_RELAXED)) {
-		dict_unregister_module(this_module->name);
-		FastQFree(this_module->name);
-		__atomic_store_n(&this_module->name_attached, false, __ATOMIC_RELEASE);
+	if (__fastq_is_futex_module(pmodule)) {
+		return __fastq_futex_wait(pmodule, seq, timeout_ms);
 	}
 
-#if defined(_FASTQ_EPOLL)
-	close(this_module->epfd);
-#endif
+	/**
+	 *  与 FastQDeleteModule 配对: 先登记再检查注册标志，删除模块看不到 _waiting
+	 *  则这里一定看到模块已被删除，不会等待已经关闭的 fd
+	 */
+	__atomic_add_fetch(&pmodule->_waiting, 1, __ATOMIC_SEQ_CST);
 
-	close(this_module->notify_new_enqueue_evt_fd);
+	if (likely(__atomic_load_n(&pmodule->already_register, __ATOMIC_SEQ_CST))) {
+		nfds = pmodule->backend->wait(pmodule, timeout_ms);
+	}
 
-	__atomic_store_n(&this_module->already_register, false, __ATOMIC_RELEASE);
+	/* 删除模块时敲门铃唤醒接收线程 */
+	if (unlikely(!__atomic_load_n(&pmodule->already_register, __ATOMIC_RELAXED))) {
+		__atomic_sub_fetch(&pmodule->_waiting, 1, __ATOMIC_RELEASE);
+		return -1;
+	}
+	if (nfds > 0) {
+		pmodule->backend->ack(pmodule);
+	}
+	__atomic_sub_fetch(&pmodule->_waiting, 1, __ATOMIC_RELEASE);
 
-	pthread_rwlock_unlock(&_AllModulesRingsLock);
+	if (nfds < 0) {
+		return errno == EINTR ? 0 : -1;
+	}
+	return 0;
+}
 
-	return true;
+static inline long
+__fastq_now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000L + now.tv_nsec;
 }
 
-bool
-FastQAttachName(const unsigned long moduleID, const char *name)
+/**
+ *  __fastq_recv_wait - 接收最多 budget 条消息
+ *
+ *  没有消息时先空转 poll_us 微秒（没有设置 FASTQ_MODULE_F_BUSY_POLL 时不空转），
+ *  再置 _sleeping 等待门铃，总时间不超过 timeout_ms；
+ *  FASTQ_MODULE_F_POLL_ONLY 一直空转到 timeout_ms
+ *
+ *  一批接收只进入一次 _rcu，轮询、检查 和 处理高优先级消息时不再修改读者计数；
+ *  睡眠前退出，空转时有等待释放的旧对象则退出再进入，见 __fastq_rcu_quiesce
+ *
+ *  return 实际处理的消息条数，接收队列被删除等错误时返回 -1
+ */
+static long
+__fastq_recv_wait(struct FastQModule *pmodule, const struct fastq_recv_handler *handler,
+		eventfd_t budget, int timeout_ms)
 {
-	if (unlikely(moduleID <= 0 || moduleID > FASTQ_ID_MAX) ) {
-		assert(0 && "Invalid moduleID.");
-		return false;
-	}
-	if (unlikely(!name)) {
-		assert(0 && "Invalid MODULE name.");
-		return false;
-	}
-	struct FastQModule *this_module = &_AllModulesRings[moduleID];
+	const long spin_ns = (pmodule->flags & FASTQ_MODULE_F_POLL_ONLY) ? LONG_MAX :
+				(pmodule->flags & FASTQ_MODULE_F_BUSY_POLL) ? pmodule->poll_us * 1000L : 0;
+	long start = 0, elapsed = 0, ret;
+	int seq;
 
-	//检查模块是否已经注册
-	if (!__atomic_load_n(&this_module->already_register, __ATOMIC_RELAXED)) {
-		fastq_log("ERROR: MODULE not registed error(id = %ld).\n", moduleID);
-		return false;
-	}
+	__fastq_rcu_enter(&pmodule->_rcu);
 
-	if (__atomic_load_n(&this_module->name_attached, __ATOMIC_RELAXED)) {
-		fastq_log("ERROR: MODULE name already attached error(id = %ld).\n", moduleID);
-		return false;
+	while (!(ret = (long)__fastq_recv_ready(pmodule, handler, budget))) {
+		if (unlikely(!__atomic_load_n(&pmodule->already_register, __ATOMIC_RELAXED))) {
+			ret = -1;
+			break;
+		}
+		if (!timeout_ms) {
+			break;
+		}
+		if (spin_ns || timeout_ms > 0) {
+			if (!start) {
+				start = __fastq_now_ns();
+			}
+			elapsed = __fastq_now_ns() - start;
+			if (timeout_ms > 0 && elapsed >= timeout_ms * 1000000L) {
+				break;
+			}
+			if (elapsed < spin_ns) {
+				__fastq_rcu_quiesce(&pmodule->_rcu);
+				__relax();
+				continue;
+			}
+		}
+
+		/* 先读 _futex 再置 _sleeping，之后的 FUTEX_WAKE 一定能唤醒 */
+		seq = __atomic_load_n(&pmodule->_futex, __ATOMIC_ACQUIRE);
+		if (!__fastq_recv_sleep(pmodule)) {
+			continue;
+		}
+		__fastq_rcu_read_unlock(&pmodule->_rcu);
+		if (__fastq_doorbell_wait(pmodule, seq,
+				timeout_ms < 0 ? -1 : timeout_ms - (int)(elapsed / 1000000L)) < 0) {
+			return -1;
+		}
+		__atomic_store_n(&pmodule->_sleeping, 0, __ATOMIC_RELAXED);
+		__fastq_rcu_enter(&pmodule->_rcu);
 	}
+	__fastq_rcu_read_unlock(&pmodule->_rcu);
 
-	mrbarrier();
-	//保存名字并添加至 字典
-	this_module->name = FastQStrdup(name);
-	mwbarrier();
+	return ret;
+}
 
-	dict_register_module(this_module->name, moduleID);
+/**
+ *  __FastQRecvPoll - 等待最多 timeout_ms 毫秒，处理最多 budget 条已就绪的消息
+ *
+ *  return 实际处理的消息条数，接收队列被删除等错误时返回 -1
+ */
+static long
+__FastQRecvPoll(unsigned int from, const struct fastq_recv_handler *handler,
+		eventfd_t budget, int timeout_ms)
+{
+	struct FastQModule *this_module = &_AllModulesRings[from];
+	long ret;
 
-	__atomic_store_n(&this_module->name_attached, true, __ATOMIC_RELEASE);
+	__fastq_recv_enter(this_module);
+	ret = __fastq_recv_wait(this_module, handler, budget, timeout_ms);
+	__fastq_recv_leave(this_module);
 
-	return true;
+	return ret;
 }
 
 /**
- *  __FastQSend - 公共发送函数
+ *  __FastQRecvMain - 接收任务 主循环
  */
 static bool
-__FastQSend(struct FastQRing *ring, unsigned long msgType,
-		unsigned long msgCode, unsigned long msgSubCode,
-		const void *msg, const size_t size)
+__FastQRecvMain(unsigned int from, const struct fastq_recv_handler *handler)
 {
-	assert(ring);
-	assert(size <= (ring->_msg_size - sizeof(size_t) - sizeof(unsigned long)*2));
-
-	unsigned int h = (ring->_head - 1) & ring->_size;
-	unsigned int t = ring->_tail;
-
-	if (t == h) {
-		return false;
-	}
-
-	char *d = &ring->_ring_data[t*ring->_msg_size];
-
-	memcpy(d, &size, sizeof(size));
-	memcpy(d + sizeof(size), &msgType, sizeof(unsigned long));
-	memcpy(d + sizeof(size) + sizeof(unsigned long), &msgCode, sizeof(unsigned long));
-	memcpy(d + sizeof(size) + sizeof(unsigned long)*2, &msgSubCode, sizeof(unsigned long));
-	memcpy(d + sizeof(size) + sizeof(unsigned long)*3, msg, size);
-
-	// Barrier is needed to make sure that item is updated
-	// before it's made available to the reader
-	mwbarrier();
+	struct FastQModule *this_module = &_AllModulesRings[from];
 
-	//统计功能
-	atomic64_inc(&ring->nr_enqueue);
+	/* 接收线程一直醒着，只在 __fastq_recv_wait 内部睡眠；删除模块后返回 -1 */
+	__fastq_recv_enter(this_module);
+	while (__fastq_recv_wait(this_module, handler, (eventfd_t)-1, -1) >= 0);
+	__fastq_recv_leave(this_module);
 
-	ring->_tail = (t + 1) & ring->_size;
 	return true;
 }
 
-static struct FastQRing *
-__create_ring_when_send(unsigned int from, unsigned int to) {
-
-	struct FastQRing *ring = NULL;
-
-	/* 创建环形队列 */
-	__fastq_create_ring(&_AllModulesRings[to], from, to);
-
-	ring = __atomic_load_n(&_AllModulesRings[to]._ring[from], __ATOMIC_RELAXED);
+/**
+ *  FastQRecv - 接收消息
+ *
+ *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   handler 消息处理函数，参照 fq_msg_handler_t 说明
+ *
+ *  return 成功true 失败false
+ *
+ *  注意：from 需要使用 FastQCreateModule 注册后使用
+ */
+bool
+FastQRecv(unsigned int from, fq_msg_handler_t handler)
+{
+	assert(handler && "NULL pointer error.");
 
-	MOD_SET(from, &_AllModulesRings[to].rx.set);
-	MOD_SET(to, &_AllModulesRings[from].tx.set);
+	if (unlikely(from <= 0 || from > FASTQ_ID_MAX) ) {
+		assert(0 && "Try to recv from not exist MODULE.\n");
+		return false;
+	}
 
-	eventfd_write(_AllModulesRings[to].notify_new_enqueue_evt_fd, 1);
+	struct fastq_recv_handler recv_handler = {
+		.mode = FASTQ_RECV_COPY,
+		.msg_handler = handler,
+	};
 
-	return ring;
+	return __FastQRecvMain(from, &recv_handler);
 }
 
 /**
- *  FastQSend - 发送消息（轮询直至成功发送）
- *
- *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
- *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
- *  param[in]   msg     传递的消息体
- *  param[in]   size    传递的消息大小
+ *  FastQRecvZeroCopy - 接收消息（零拷贝）
  *
- *  return 成功true （轮询直至发送成功，只可能返回 true ）
+ *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   handler 消息处理函数，参照 fq_msg_zc_handler_t 说明
  *
- *  注意：from 和 to 需要使用 FastQCreateModule 注册后使用
+ *  return 成功true 失败false
  */
 bool
-FastQSend(unsigned int from, unsigned int to, unsigned long msgType,
-				unsigned long msgCode, unsigned long msgSubCode,
-				const void *msg, size_t size)
+FastQRecvZeroCopy(unsigned int from, fq_msg_zc_handler_t handler)
 {
+	assert(handler && "NULL pointer error.");
 
-	struct FastQRing *ring = __atomic_load_n(&_AllModulesRings[to]._ring[from], __ATOMIC_RELAXED);
-	if(unlikely(!ring)) {
-		ring = __create_ring_when_send(from, to);
+	if (unlikely(from <= 0 || from > FASTQ_ID_MAX) ) {
+		assert(0 && "Try to recv from not exist MODULE.\n");
+		return false;
 	}
-	while (!__FastQSend(ring, msgType, msgCode, msgSubCode, msg, size)) {__relax();}
 
-	eventfd_write(ring->_evt_fd, 1);
+	struct fastq_recv_handler recv_handler = {
+		.mode = FASTQ_RECV_ZEROCOPY,
+		.zc_handler = handler,
+	};
 
-	return true;
+	return __FastQRecvMain(from, &recv_handler);
 }
 
+/**
+ *  FastQRecvBurst - 批量接收消息
+ *
+ *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   handler 批量消息处理函数，参照 fq_burst_handler_t 说明
+ *
+ *  return 成功true 失败false
+ */
 bool
-FastQSendByName(const char* from, const char* to, unsigned long msgType,
-				unsigned long msgCode, unsigned long msgSubCode,
-				const void *msg, size_t size)
+FastQRecvBurst(unsigned int from, fq_burst_handler_t handler)
 {
-	assert(from && "NULL string.");
-	assert(to && "NULL string.");
-
-	unsigned long from_id = dict_find_module_id_byname((char *)from);
-	unsigned long to_id = dict_find_module_id_byname((char *)to);
+	assert(handler && "NULL pointer error.");
 
-	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
-		return false;
-	} if(unlikely(!__atomic_load_n(&_AllModulesRings[to_id].already_register, __ATOMIC_RELAXED))) {
+	if (unlikely(from <= 0 || from > FASTQ_ID_MAX) ) {
+		assert(0 && "Try to recv from not exist MODULE.\n");
 		return false;
 	}
-	return FastQSend(from_id, to_id, msgType, msgCode, msgSubCode, msg, size);
+
+	struct fastq_recv_handler recv_handler = {
+		.mode = FASTQ_RECV_BURST,
+		.burst_handler = handler,
+	};
+
+	return __FastQRecvMain(from, &recv_handler);
 }
 
 /**
- *  FastQTrySend - 发送消息（尝试向队列中插入，当队列满是直接返回false）
+ *  FastQRecvOnce - 处理已就绪的消息后立即返回
  *
- *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
- *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
- *  param[in]   msg     传递的消息体
- *  param[in]   size    传递的消息大小
+ *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   handler 消息处理函数，参照 fq_msg_handler_t 说明
+ *  param[in]   max_msgs    本次最多处理的消息数，0 表示不限制
+ *  param[in]   timeout_ms  没有就绪消息时最多等待的毫秒数，-1 一直等待，0 不等待
  *
- *  return 成功true 失败false
+ *  return 本次处理的消息数，超时返回 0，模块不存在或已被删除返回 -1
  *
- *  注意：from 和 to 需要使用 FastQCreateModule 注册后使用
+ *  注意：超出 max_msgs 的消息留在队列中，对应的 fd 保持可读
  */
-bool
-FastQTrySend(unsigned int from, unsigned int to, unsigned long msgType,
-				unsigned long msgCode, unsigned long msgSubCode,
-				const void *msg, size_t size)
+long
+FastQRecvOnce(unsigned int from, fq_msg_handler_t handler,
+			unsigned int max_msgs, int timeout_ms)
 {
+	assert(handler && "NULL pointer error.");
 
-	struct FastQRing *ring = __atomic_load_n(&_AllModulesRings[to]._ring[from], __ATOMIC_RELAXED);
-	if(unlikely(!ring)) {
-		ring = __create_ring_when_send(from, to);
+	if (unlikely(from <= 0 || from > FASTQ_ID_MAX) ) {
+		assert(0 && "Try to recv from not exist MODULE.\n");
+		return -1;
 	}
-	bool ret = __FastQSend(ring, msgType, msgCode, msgSubCode, msg, size);
-	if(ret) {
-		eventfd_write(ring->_evt_fd, 1);
+	if (unlikely(!__atomic_load_n(&_AllModulesRings[from].already_register, __ATOMIC_RELAXED))) {
+		return -1;
 	}
-	return ret;
+
+	struct fastq_recv_handler recv_handler = {
+		.mode = FASTQ_RECV_COPY,
+		.msg_handler = handler,
+	};
+
+	return __FastQRecvPoll(from, &recv_handler,
+			max_msgs ? (eventfd_t)max_msgs : (eventfd_t)-1, timeout_ms);
+}
+
+/**
+ *  FastQGetFd - 获取模块的就绪通知 fd，用于接入外部事件循环
+ *
+ *  param[in]   module  模块ID， 范围 1 - FASTQ_ID_MAX
+ *
+ *  return 门铃 eventfd、epoll fd 或 io_uring fd，有消息可接收时可读；futex 后端没有 fd，返回 -1
+ *
+ *  注意：fd 可读后调用 FastQRecvOnce(module, handler, n, 0) 处理消息，不要直接读取
+ */
+int
+FastQGetFd(unsigned int module)
+{
+	if (unlikely(module <= 0 || module > FASTQ_ID_MAX) ) {
+		return -1;
+	}
+	if (unlikely(!__atomic_load_n(&_AllModulesRings[module].already_register, __ATOMIC_RELAXED))) {
+		return -1;
+	}
+	return _AllModulesRings[module].backend->fd(&_AllModulesRings[module]);
 }
 
 bool
-FastQTrySendByName(const char* from, const char* to, unsigned long msgType,
-				unsigned long msgCode, unsigned long msgSubCode,
-				const void *msg, size_t size)
+FastQRecvBurstByName(const char *from, fq_burst_handler_t handler)
 {
 	assert(from && "NULL string.");
-	assert(to && "NULL string.");
 	unsigned long from_id = dict_find_module_id_byname((char *)from);
-	unsigned long to_id = dict_find_module_id_byname((char *)to);
 	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
-		return false;
-	} if(unlikely(!__atomic_load_n(&_AllModulesRings[to_id].already_register, __ATOMIC_RELAXED))) {
+		fastq_log("No such module %s.\n", from);
 		return false;
 	}
-
-	return FastQTrySend(from_id, to_id, msgType, msgCode, msgSubCode, msg, size);
+	return FastQRecvBurst(from_id, handler);
 }
 
-static bool
-__FastQRecv(struct FastQRing *ring, unsigned long *type, unsigned long *code,
-		unsigned long *subcode, void *msg, size_t *size)
+bool
+FastQRecvByName(const char *from, fq_msg_handler_t handler)
 {
-	unsigned int t = ring->_tail;
-	unsigned int h = ring->_head;
-	if (h == t) {
+	assert(from && "NULL string.");
+	unsigned long from_id = dict_find_module_id_byname((char *)from);
+	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
+		fastq_log("No such module %s.\n", from);
 		return false;
 	}
-
-	char *d = &ring->_ring_data[h*ring->_msg_size];
-
-	size_t recv_size;
-	unsigned long msgType;
-	unsigned long msgCode;
-	unsigned long msgSubCode;
-
-	memcpy(&recv_size, d, sizeof(size_t));
-	memcpy(&msgType, d+sizeof(size_t), sizeof(unsigned long));
-	memcpy(&msgCode, d+sizeof(size_t)+sizeof(unsigned long), sizeof(unsigned long));
-	memcpy(&msgSubCode, d+sizeof(size_t)+sizeof(unsigned long)*2, sizeof(unsigned long));
-
-	if(unlikely(recv_size > *size)) {
-		printf("recv size %ld > buff size %ld\n", recv_size, *size);
-		assert(recv_size <= *size && "buffer too small");
-	}
-	*size = recv_size;
-	*type = msgType;
-	*code = msgCode;
-	*subcode = msgSubCode;
-
-	memcpy(msg, d + sizeof(size_t) + sizeof(unsigned long)*3, recv_size);
-
-	mbarrier();
-	//统计功能
-	atomic64_inc(&ring->nr_dequeue);
-
-	ring->_head = (h + 1) & ring->_size;
-	return true;
+	return FastQRecv(from_id, handler);
 }
 
 /**
- *  FastQRecv - 接收消息
- *
- *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
- *  param[in]   handler 消息处理函数，参照 fq_msg_handler_t 说明
- *
- *  return 成功true 失败false
+ *  FastQPeek - 查看 src 发往 dst 的队首消息（不出队）
  *
- *  注意：from 需要使用 FastQCreateModule 注册后使用
+ *  msg->msg 直接指向 ring 中的节点，调用 FastQRelease 之前一直有效
  */
 bool
-FastQRecv(unsigned int from, fq_msg_handler_t handler)
+FastQPeek(unsigned int dst, unsigned int src, struct FastQRecvMsg *msg)
 {
-	assert(handler && "NULL pointer error.");
+	assert(msg && "NULL pointer error.");
 
-	if (unlikely(from <= 0 || from > FASTQ_ID_MAX) ) {
-		assert(0 && "Try to recv from not exist MODULE.\n");
+	if (unlikely(dst <= 0 || dst > FASTQ_ID_MAX || src > FASTQ_ID_MAX)) {
 		return false;
 	}
 
-	eventfd_t cnt;
-	int nfds;
-	int loop_flags = 1;
-
-#if defined(_FASTQ_EPOLL)
-	struct epoll_event events[32];
-#elif defined(_FASTQ_SELECT)
-	int i, max_fd;
-#endif
+	struct FastQRing *ring = __atomic_load_n(&_AllModulesRings[dst]._ring[src], __ATOMIC_ACQUIRE);
+	if (unlikely(!ring)) {
+		return false;
+	}
 
-	int curr_event_fd;
-	char __attribute__((aligned(64))) addr[4096] = {0}; //page size
-	size_t size = sizeof(addr);
-	struct FastQRing *ring = NULL;
-	fd_set readset;
-	unsigned long msgType, msgCode, msgSubCode;
+	ring = __fastq_ring_rx(ring);
+	do {
+		if (__fastq_is_ow(ring) ? __fastq_ow_recv(ring, msg, false) :
+				__FastQRecvBurst(ring, msg, 1)) {
+			return true;
+		}
+	} while ((ring = __fastq_ring_migrate(ring)));
 
-	struct FastQModule *this_module = &_AllModulesRings[from];
+	return false;
+}
 
-	/* 接收任务 主循环 */
-	while (loop_flags) {
+/**
+ *  FastQRelease - 归还 FastQPeek 查看的队首消息（出队）
+ */
+bool
+FastQRelease(unsigned int dst, unsigned int src)
+{
+	if (unlikely(dst <= 0 || dst > FASTQ_ID_MAX || src > FASTQ_ID_MAX)) {
+		return false;
+	}
 
-#if defined(_FASTQ_EPOLL)
+	struct FastQRing *ring = __atomic_load_n(&_AllModulesRings[dst]._ring[src], __ATOMIC_ACQUIRE);
+	struct FastQRecvMsg msg;
 
-		nfds = epoll_wait(this_module->epfd, events, 32, -1);
-#elif defined(_FASTQ_SELECT)
+	if (unlikely(!ring)) {
+		return false;
+	}
 
-		readset = this_module->selector.readset;
-		max_fd = this_module->selector.maxfd;
-		nfds = select(max_fd+1, &readset, NULL, NULL, NULL);
-#endif
-		/* 如果队列被动态删除了， epoll 和 select 将返回 -1,此时应该退出 while(1) 循环 */
-		loop_flags = (nfds==-1)?0:1;
+	ring = __fastq_ring_rx(ring);
+	if (__fastq_is_ow(ring)) {
+		/* FastQPeek 查看的消息可能已被覆盖，此时已经出队 */
+		unsigned int h = ring->_head_next;
 
-		if(!loop_flags) {   /* 这里可能由于销毁了接收队列，epoll_wait将返回失败 */
-				break;
+		if (__atomic_compare_exchange_n(&ring->_head, &h, (h + 1) & ring->_size, 0,
+				__ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+			//统计功能
+			__fastq_stat_add(ring->nr_dequeue, 1);
+			__fastq_head_wake(ring);
 		}
+		return true;
+	}
 
-#if defined(_FASTQ_EPOLL)
-		for(;nfds--;) {
-				curr_event_fd = events[nfds].data.fd;
-#elif defined(_FASTQ_SELECT)
-
-		for (i = 3; i <= max_fd; ++i) {
-			if(!FD_ISSET(i, &readset)) {
-			continue;
-			}
-			nfds--;
-			curr_event_fd = i;
-#endif
-			/* 接收新注册的队列的 event 消息，用于 刷新 select() 的 readset   */
-			if (curr_event_fd == this_module->notify_new_enqueue_evt_fd) {
-				eventfd_read(curr_event_fd, &cnt);
-				continue;
-			}
-
-			/* 从快表中查询 FD 对应的 环形队列 */
-			ring = __atomic_load_n(&_evtfd_to_ring[curr_event_fd].tlb_ring, __ATOMIC_RELAXED);
-			if(unlikely(!ring)) {
-			continue;
-			}
-
-			/* 获取接收的 packet 数量 */
-			eventfd_read(curr_event_fd, &cnt);
+	if (unlikely(!__FastQRecvBurst(ring, &msg, 1))) {
+		return false;
+	}
 
-			/* 轮询接收 */
-			for (; cnt--;) {
-				size = sizeof(addr);
-				while (!__FastQRecv(ring, &msgType, &msgCode, &msgSubCode,
-							addr, &size)) {
-					__relax();
-				}
-				/**
-				 *  动态删除模块时，可能导致 src/dst 失效
-				 */
-				if (unlikely(ring->src > FASTQ_ID_MAX) ||
-					unlikely(ring->dst > FASTQ_ID_MAX)) {
-					break;
-				}
+	__FastQRecvBurstDone(ring, 1);
 
-				/* 调用应用层 接收函数 */
-				handler(ring->src, ring->dst,
-					msgType, msgCode, msgSubCode,
-					(void*)addr, size);
-			}
-		}
-	}
 	return true;
 }
 
-bool
-FastQRecvByName(const char *from, fq_msg_handler_t handler)
+
+/**
+ *  __fastq_ring_stats - 读取 ring 的统计信息（包括高优先级队列）
+ *
+ *  先读出队数再读入队数，保证 入队数 >= 出队数 的一致快照；
+ *  丢弃数不需要开启统计功能
+ *
+ *  return 成功true 未开启统计功能false
+ */
+static bool
+__fastq_ring_stats(struct FastQRing *ring, unsigned long *enqueue,
+		unsigned long *dequeue, unsigned long *dropped)
 {
-	assert(from && "NULL string.");
-	unsigned long from_id = dict_find_module_id_byname((char *)from);
-	if(unlikely(!__atomic_load_n(&_AllModulesRings[from_id].already_register, __ATOMIC_RELAXED))) {
-		fastq_log("No such module %s.\n", from);
-		return false;
+	*dropped = __atomic_load_n(&ring->_dropped, __ATOMIC_RELAXED);
+
+#if defined(_FASTQ_STATS)
+	struct FastQRing *hi = __atomic_load_n(&ring->_prio, __ATOMIC_ACQUIRE);
+
+	*dequeue = __atomic_load_n(&ring->nr_dequeue, __ATOMIC_ACQUIRE);
+	if (hi) {
+		*dequeue += __atomic_load_n(&hi->nr_dequeue, __ATOMIC_ACQUIRE);
 	}
-	return FastQRecv(from_id, handler);
+	*enqueue = __atomic_load_n(&ring->nr_enqueue, __ATOMIC_ACQUIRE);
+	if (hi) {
+		*enqueue += __atomic_load_n(&hi->nr_enqueue, __ATOMIC_ACQUIRE);
+	}
+	return true;
+#else
+	*enqueue = *dequeue = 0;
+	return false;
+#endif
 }
 
-
 /**
  *  FastQInfo - 查询信息
  *
@@ -1192,20 +5443,33 @@ FastQMsgStatInfo(struct FastQModuleMsgStatInfo *buf, unsigned int buf_mod_size,
 	assert(buf && num && "NULL pointer error.");
 	assert(buf_mod_size && "buf_mod_size MUST bigger than zero.");
 
-	unsigned long dstID, srcID, bufIdx = 0;
 	*num = 0;
 
-	for (dstID = 1; dstID <= FASTQ_ID_MAX; dstID++) {
-		if (!__atomic_load_n(&_AllModulesRings[dstID].already_register, __ATOMIC_ACQUIRE)) {
-				continue;
-		}
-		if (!__atomic_load_n(&_AllModulesRings[dstID]._ring, __ATOMIC_ACQUIRE)) {
-				continue;
-		}
+#if !defined(_FASTQ_STATS)
+	(void)filter;
+	return false;
+#else
+	struct fastq_id_list *modules, *srcs;
+	struct FastQModule *pmodule;
+	struct FastQRing *ring;
+	unsigned long dstID, srcID, bufIdx = 0;
+	unsigned int i, j;
 
-		for (srcID = 0; srcID <= FASTQ_ID_MAX; srcID++) {
-			if(!__atomic_load_n(&_AllModulesRings[dstID]._ring[srcID], __ATOMIC_ACQUIRE)) {
-			continue;
+	/* 只遍历已注册的模块 和 它们的活跃队列 */
+	modules = __fastq_rcu_read_lock(&_AllModulesListRcu, &_AllModulesList);
+
+	for (i = 0; modules && i < modules->nr && bufIdx < buf_mod_size; i++) {
+		dstID = modules->id[i];
+		pmodule = &_AllModulesRings[dstID];
+
+		srcs = __fastq_rcu_read_lock(&pmodule->_rcu, &pmodule->_rx_list);
+
+		for (j = 0; srcs && j < srcs->nr && bufIdx < buf_mod_size; j++) {
+			srcID = srcs->id[j];
+
+			ring = __atomic_load_n(&pmodule->_ring[srcID], __ATOMIC_ACQUIRE);
+			if (!ring) {
+				continue;
 			}
 
 			//过滤掉一些
@@ -1215,17 +5479,18 @@ FastQMsgStatInfo(struct FastQModuleMsgStatInfo *buf, unsigned int buf_mod_size,
 			buf[bufIdx].src_module = srcID;
 			buf[bufIdx].dst_module = dstID;
 
-			buf[bufIdx].enqueue = atomic64_read(&_AllModulesRings[dstID]._ring[srcID]->nr_enqueue);
-			buf[bufIdx].dequeue = atomic64_read(&_AllModulesRings[dstID]._ring[srcID]->nr_dequeue);
+			__fastq_ring_stats(ring,
+				&buf[bufIdx].enqueue, &buf[bufIdx].dequeue, &buf[bufIdx].dropped);
 
 			bufIdx++;
 			(*num)++;
-
-			if (buf_mod_size == bufIdx)
-				return true;
 		}
+		__fastq_rcu_read_unlock(&pmodule->_rcu);
 	}
+	__fastq_rcu_read_unlock(&_AllModulesListRcu);
+
 	return true;
+#endif
 }
 
 /**
@@ -1238,11 +5503,11 @@ FastQMsgStatInfo(struct FastQModuleMsgStatInfo *buf, unsigned int buf_mod_size,
  *  Module ID 1 register in file <test.c>'s function <new_dequeue_task> at line 278
  *  ------------------------------------------
  *  ID:   1, msgMax    8, msgSize    8
- *  	(Name:ID)from   ->       to                  enqueue          dequeue          current
- *  	     NODE_1:1   ->    NODE_1:1                    11               11                0
- *  	     NODE_2:2   ->    NODE_1:1                701438           701431               -1
- *  	     NODE_3:3   ->    NODE_1:1                798511           798506               -1
- *  	     NODE_4:4   ->    NODE_1:1                719606           719599               -1
+ *  	(Name:ID)from   ->       to                  enqueue          dequeue          current          dropped
+ *  	     NODE_1:1   ->    NODE_1:1                    11               11                0                0
+ *  	     NODE_2:2   ->    NODE_1:1                701438           701431               -1                0
+ *  	     NODE_3:3   ->    NODE_1:1                798511           798506               -1                0
+ *  	     NODE_4:4   ->    NODE_1:1                719606           719599               -1                0
  *  	 Total enqueue          2219566, dequeue          2219547
  */
 void
@@ -1252,18 +5517,22 @@ FastQDump(FILE*fp, unsigned long module_id)
 		fp = stderr;
 	}
 
-	unsigned long i, j, max_module = FASTQ_ID_MAX;
+	struct fastq_id_list *modules, *srcs;
+	unsigned long i, j;
+	unsigned int m, n, nr_modules;
+
+	/* 只遍历已注册的模块 和 它们的活跃队列 */
+	modules = __fastq_rcu_read_lock(&_AllModulesListRcu, &_AllModulesList);
 
 	if (module_id == 0 || module_id > FASTQ_ID_MAX) {
-		i = 1;
-		max_module = FASTQ_ID_MAX;
+		nr_modules = modules ? modules->nr : 0;
 	} else {
-		i = module_id;
-		max_module = module_id;
+		nr_modules = 1;
 	}
 
+	for (m = 0; m < nr_modules; m++) {
+		i = (module_id == 0 || module_id > FASTQ_ID_MAX) ? modules->id[m] : module_id;
 
-	for (; i <= max_module; i++) {
 		if(!__atomic_load_n(&_AllModulesRings[i].already_register, __ATOMIC_RELAXED)) {
 				continue;
 		}
@@ -1273,44 +5542,63 @@ FastQDump(FILE*fp, unsigned long module_id)
 				_AllModulesRings[i]._file,
 				_AllModulesRings[i]._func,
 				_AllModulesRings[i]._line);
-		atomic64_t module_total_msgs[2];
-		atomic64_init(&module_total_msgs[0]); //总入队数量
-		atomic64_init(&module_total_msgs[1]); //总出队数量
+		unsigned long module_total_msgs[2] = {0, 0}; //总入队数量, 总出队数量
+		unsigned long enqueue, dequeue, dropped;
+		struct FastQRing *ring;
 		_fastq_fprintf(fp, "------------------------------------------\n"\
-				"ID: %3ld, msgMax %4u, msgSize %4u\n"\
+				"ID: %3ld, %s %4u, msgSize %4u\n"\
 				"\t(Name:ID)from   ->       to        "
-				" %16s %16s %16s "
+				" %16s %16s %16s %16s "
 				"\n"
 				, i,
+				(_AllModulesRings[i].flags & FASTQ_MODULE_F_VARLEN) ? "ringBytes" : "msgMax",
 				_AllModulesRings[i].ring_size,
 				_AllModulesRings[i].msg_size,
-				"enqueue", "dequeue", "current"
+				"enqueue", "dequeue", "current", "dropped"
 				);
 
-		for (j = 0; j <= FASTQ_ID_MAX; j++) {
-			if(__atomic_load_n(&_AllModulesRings[i]._ring[j], __ATOMIC_RELAXED)) {
+		srcs = __fastq_rcu_read_lock(&_AllModulesRings[i]._rcu, &_AllModulesRings[i]._rx_list);
+
+		for (n = 0; srcs && n < srcs->nr; n++) {
+			j = srcs->id[n];
+			ring = __atomic_load_n(&_AllModulesRings[i]._ring[j], __ATOMIC_RELAXED);
+			if(ring) {
+				__fastq_ring_stats(ring, &enqueue, &dequeue, &dropped);
 				_fastq_fprintf(fp,
 					"\t %10s:%-4ld->%10s:%-4ld  "
-					" %16ld %16ld %16d"
+#if defined(_FASTQ_STATS)
+					" %16ld %16ld %16d %16ld"
+#else
+					" %16s %16s %16d %16ld"
+#endif
 					"\n" , \
 					_AllModulesRings[j].name, j,
 					_AllModulesRings[i].name, i,
-					atomic64_read(&_AllModulesRings[i]._ring[j]->nr_enqueue),
-					atomic64_read(&_AllModulesRings[i]._ring[j]->nr_dequeue),
-					(int)(_AllModulesRings[i]._ring[j]->_tail - _AllModulesRings[i]._ring[j]->_head));
-
-				atomic64_add(&module_total_msgs[0],
-					atomic64_read(&_AllModulesRings[i]._ring[j]->nr_enqueue));
+#if defined(_FASTQ_STATS)
+					enqueue, dequeue,
+#else
+					"-", "-",
+#endif
+					(int)(__fastq_is_mp(ring) ? ring->_tail - ring->_head :
+						(ring->_tail - ring->_head) & ring->_size),
+					dropped);
 
-				atomic64_add(&module_total_msgs[1],
-					atomic64_read(&_AllModulesRings[i]._ring[j]->nr_dequeue));
+				module_total_msgs[0] += enqueue;
+				module_total_msgs[1] += dequeue;
 			}
 		}
+		__fastq_rcu_read_unlock(&_AllModulesRings[i]._rcu);
 
+#if defined(_FASTQ_STATS)
 		_fastq_fprintf(fp, "\t Total enqueue %16ld, dequeue %16ld\n",
-			atomic64_read(&module_total_msgs[0]),
-			atomic64_read(&module_total_msgs[1]));
+			module_total_msgs[0],
+			module_total_msgs[1]);
+#else
+		_fastq_fprintf(fp, "\t Total enqueue/dequeue: stats disabled (build with -D_FASTQ_STATS)\n");
+#endif
 	}
+	__fastq_rcu_read_unlock(&_AllModulesListRcu);
+
 	fflush(fp);
 	return;
 }
@@ -1327,18 +5615,35 @@ FastQMsgNum(unsigned int ID,
 		return false;
 	}
 
-	int i;
+#if !defined(_FASTQ_STATS)
+	(void)nr_enqueues;
+	(void)nr_dequeues;
+	(void)nr_currents;
+	return false;
+#else
+	struct FastQModule *pmodule = &_AllModulesRings[ID];
+	struct fastq_id_list *srcs;
+	unsigned int i;
+	unsigned long enqueue, dequeue, dropped;
+	struct FastQRing *ring;
 	*nr_dequeues = *nr_enqueues = *nr_currents = 0;
 
-	for (i = 1; i <= FASTQ_ID_MAX; i++) {
-		if (MOD_ISSET(i, &_AllModulesRings[ID].rx.set)) {
-			*nr_enqueues += atomic64_read(&_AllModulesRings[ID]._ring[i]->nr_enqueue);
-			*nr_dequeues += atomic64_read(&_AllModulesRings[ID]._ring[i]->nr_dequeue);
+	srcs = __fastq_rcu_read_lock(&pmodule->_rcu, &pmodule->_rx_list);
+	for (i = 0; srcs && i < srcs->nr; i++) {
+		ring = __atomic_load_n(&pmodule->_ring[srcs->id[i]], __ATOMIC_ACQUIRE);
+		if (ring) {
+			__fastq_ring_stats(ring, &enqueue, &dequeue, &dropped);
+			*nr_enqueues += enqueue;
+			*nr_dequeues += dequeue;
+			/* 被覆盖的消息入过队，但不会被接收 */
+			*nr_currents -= __atomic_load_n(&ring->nr_overwrite, __ATOMIC_RELAXED);
 		}
 	}
+	__fastq_rcu_read_unlock(&pmodule->_rcu);
 
-	*nr_currents = (*nr_enqueues) - (*nr_dequeues);
+	*nr_currents += (*nr_enqueues) - (*nr_dequeues);
 
 	return true;
+#endif
 }
 #pragma GCC diagnostic pop
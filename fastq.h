@@ -8,17 +8,43 @@
 * API接口概述
 *
 *   FastQCreateModule   注册消息队列
+*   FastQCreateModuleAttr   注册消息队列（指定模块属性，见 FastQModuleAttr）
 *   FastQDeleteModule   删除消息队列
 *   FastQDump           显示信息
 *   FastQDumpAllModule  显示信息（所有模块）
-*   FastQMsgStatInfo    查询队列内存入队出队信息
+*   FastQMsgStatInfo    查询队列内存入队出队信息(需要开启统计功能 _FASTQ_STATS )
 *   FastQSend           发送消息（轮询直至成功发送）
 *   FastQSendByName         模块名索引版本
 *   FastQTrySend        发送消息（尝试向队列中插入，当队列满是直接返回false）
+*   FastQSendTimed      发送消息（队列满时最多等待指定时间）
 *   FastQTrySendByName      模块名索引版本
+*   FastQSendPrio       按优先级发送消息（高优先级消息先于所有普通消息被接收）
+*   FastQTrySendPrio    按优先级发送消息（队列满时直接返回false）
+*   FastQSendPrioTimed  按优先级发送消息（队列满时最多等待指定时间）
+*   FastQSendBatch      批量发送消息（轮询直至全部发送）
+*   FastQSendBatchByName    模块名索引版本
+*   FastQTrySendBatch   批量发送消息（尝试发送，返回实际发送数）
+*   FastQSendBatchTimed 批量发送消息（队列满时最多等待指定时间，返回实际发送数）
+*   FastQTrySendBatchByName 模块名索引版本
+*   FastQBroadcast      广播消息（消息体只拷贝一次，所有接收模块共享）
+*   FastQBroadcastTimed 广播消息（广播队列满时最多等待指定时间）
+*   FastQReserve        申请发送节点（零拷贝，轮询直至申请成功）
+*   FastQTryReserve     申请发送节点（零拷贝，队列满时返回 NULL）
+*   FastQReserveTimed   申请发送节点（零拷贝，队列满时最多等待指定时间）
+*   FastQCommit         发送已申请的节点
 *   FastQRecv           接收消息
+*   FastQRecvZeroCopy   接收消息（零拷贝，回调直接读取队列节点）
+*   FastQRecvBurst      批量接收消息（一次唤醒 一次回调处理多条消息）
+*   FastQRecvBurstByName    模块名索引版本
+*   FastQRecvOnce       处理已就绪的消息后立即返回（可限制条数和等待时间）
+*   FastQGetFd          获取模块的就绪通知 fd（接入外部事件循环）
+*   FastQPeek           查看队首消息（零拷贝，不出队）
+*   FastQRelease        归还 FastQPeek 查看的消息（出队）
 *   FastQMsgNum         获取消息数(需要开启统计功能 _FASTQ_STATS )
 *   FastQAddSet         动态添加 发送接收 set
+*   FastQResizeRing     调整队列大小（不丢失队列中的消息）
+*   FastQConfigureEdge  按源模块配置队列大小和消息大小
+*   FastQSetFullPolicy  按源模块配置队列满时的处理策略（阻塞、丢弃、覆盖）
 *
 *
 \******************************************************************************/
@@ -83,6 +109,146 @@ typedef struct {
  */
 #define FastQTmpModuleID    0
 
+/**
+ *  FastQModuleAttr - 模块属性， 见 FastQCreateModuleAttr
+ *
+ *  flags       FASTQ_MODULE_F_* 标志位，作用于所有发往该模块的队列，
+ *              FASTQ_MODULE_F_MPSC 同时作用于该模块发出的队列
+ *  ring_bytes  变长队列 的字节数（向上取 2 的幂），为 0 时取 msgMax 条最大消息的大小
+ *  ring_max    FASTQ_MODULE_F_AUTO_GROW 自动扩容的上限（消息数，向上取 2 的幂），
+ *              为 0 时取 msgMax * FASTQ_AUTO_GROW_DEFAULT
+ *  policy      FASTQ_FULL_* 发往该模块的队列满时的处理策略，默认 FASTQ_FULL_BLOCK
+ *  poll_us     FASTQ_MODULE_F_BUSY_POLL 接收线程没有消息时空转的微秒数，
+ *              为 0 时取 FASTQ_POLL_US_DEFAULT
+ *  backend     FASTQ_BACKEND_* 该模块接收时使用的通知后端，默认 FASTQ_BACKEND_DEFAULT
+ */
+struct FastQModuleAttr {
+	unsigned long flags;
+	unsigned int ring_bytes;
+	unsigned int ring_max;
+	unsigned int policy;
+	unsigned int poll_us;
+	unsigned int backend;
+};
+
+/**
+ *  FASTQ_MODULE_F_VARLEN - 变长队列
+ *
+ *  发往该模块的队列按字节分配，每条消息只占用 消息头 + 实际大小（8字节对齐），
+ *  而不是 FastQCreateModule 的 msgSize，适合大部分消息很小、偶尔很大的模块
+ */
+#define FASTQ_MODULE_F_VARLEN   0x00000001UL
+
+/**
+ *  FASTQ_MODULE_F_MPSC - 多入单出队列
+ *
+ *  该模块发出和收到的队列允许多个线程同时以同一个源模块发送，
+ *  生产者之间用 CAS 申请节点，比单入单出队列 每条消息多一次 lock 指令，
+ *  源模块或目的模块设置了该标志时，发往 FASTQ_MODULE_F_VARLEN 模块的队列退化为定长队列，
+ *  节点大小取 msgSize，节点数取 ring_bytes 能放下的最大消息数
+ *
+ *  注意：多入单出队列 的 FastQReserve 每个线程同时只能有一个未提交的申请
+ */
+#define FASTQ_MODULE_F_MPSC     0x00000002UL
+
+/**
+ *  FASTQ_MODULE_F_MULTI_CONSUMER - 多消费者模式
+ *
+ *  允许多个线程同时对该模块调用 FastQRecv/FastQRecvBurst，消息在线程之间分摊，不重复。
+ *  以发往该模块的队列为单位分配：同一个队列同时只被一个线程处理（同一源模块的消息保序），
+ *  不同源模块的队列由不同线程并行处理
+ *
+ *  注意：每个队列由空变为非空时敲一次门铃，可能同时唤醒多个线程，未抢到队列的线程继续睡眠
+ */
+#define FASTQ_MODULE_F_MULTI_CONSUMER   0x00000004UL
+
+/**
+ *  FASTQ_MODULE_F_AUTO_GROW - 队列自动扩容
+ *
+ *  发往该模块的队列满时，发送者将队列大小翻倍（不超过 FastQModuleAttr.ring_max），
+ *  而不是轮询等待或返回失败。旧队列中的消息不拷贝，接收者读空旧队列后再切换到新队列，
+ *  消息顺序不变。见 FastQResizeRing
+ *
+ *  注意：对 FASTQ_MODULE_F_MPSC 和 FASTQ_MODULE_F_MULTI_CONSUMER 队列无效
+ */
+#define FASTQ_MODULE_F_AUTO_GROW    0x00000008UL
+
+#ifndef FASTQ_AUTO_GROW_DEFAULT
+#define FASTQ_AUTO_GROW_DEFAULT     16
+#endif
+
+/**
+ *  FASTQ_MODULE_F_BUSY_POLL - 接收线程忙轮询
+ *
+ *  接收线程处理完消息后继续轮询发往该模块的队列 FastQModuleAttr.poll_us 微秒，
+ *  仍然没有消息才睡眠。接收线程醒着时发送方不敲门铃，负载持续时
+ *  收发路径上几乎没有系统调用；空闲时接收线程睡眠，不占用 CPU
+ *
+ *  注意：不能与 FASTQ_MODULE_F_MULTI_CONSUMER 同时使用；
+ *       接收线程轮流检查发往该模块的所有队列，源模块很多时单次轮询的开销随之增大
+ */
+#define FASTQ_MODULE_F_BUSY_POLL    0x00000010UL
+
+/**
+ *  FASTQ_MODULE_F_POLL_ONLY - 接收线程只轮询，从不睡眠（隐含 FASTQ_MODULE_F_BUSY_POLL）
+ *
+ *  用于独占 CPU 核的模块：接收线程轮流检查发往该模块的所有队列，
+ *  发送方（包括广播）不敲门铃、不加内存屏障，收发路径上没有系统调用；
+ *  接收线程一直占满一个 CPU，FastQRecvOnce 空转到 timeout_ms
+ *
+ *  注意：不能与 FASTQ_MODULE_F_MULTI_CONSUMER 同时使用；
+ *       没有就绪通知，不能通过 FastQGetFd 接入外部事件循环
+ */
+#define FASTQ_MODULE_F_POLL_ONLY    0x00000020UL
+
+#ifndef FASTQ_POLL_US_DEFAULT
+#define FASTQ_POLL_US_DEFAULT       50
+#endif
+
+/**
+ *  FASTQ_FULL_* - 队列满时的处理策略，见 FastQModuleAttr.policy 和 FastQSetFullPolicy
+ *
+ *  FASTQ_FULL_BLOCK        FastQSend 轮询等待，FastQTrySend 返回 false（默认）
+ *  FASTQ_FULL_DROP_NEWEST  丢弃新消息，FastQSend 不等待，直接返回 false
+ *  FASTQ_FULL_OVERWRITE    覆盖最旧的消息，发送总是成功，接收方总是看到最新的消息；
+ *                          只支持定长的单入单出队列，接收方每条消息多一次拷贝；
+ *                          FASTQ_MODULE_F_MPSC 模块注册时不能使用，FastQSetFullPolicy 返回 false，
+ *                          目的模块默认覆盖、源模块是 FASTQ_MODULE_F_MPSC 时按 DROP_NEWEST 处理；
+ *                          高优先级消息 (FastQSendPrio) 同 FASTQ_FULL_BLOCK
+ *  FASTQ_FULL_DROP_PRIO    普通消息同 FASTQ_FULL_DROP_NEWEST，
+ *                          高优先级消息 (FastQSendPrio) 同 FASTQ_FULL_BLOCK，只丢弃普通消息
+ *
+ *  丢弃（包括被覆盖）的消息数见 FastQModuleMsgStatInfo.dropped 和 FastQDump
+ */
+#define FASTQ_FULL_BLOCK        0
+#define FASTQ_FULL_DROP_NEWEST  1
+#define FASTQ_FULL_OVERWRITE    2
+#define FASTQ_FULL_DROP_PRIO    3
+
+/**
+ *  FASTQ_BACKEND_* - 接收模块的通知后端，见 FastQModuleAttr.backend
+ *
+ *  每个模块注册时选择，同一进程中的不同模块可以使用不同的后端；
+ *  每个模块只有一个门铃，与发往该模块的队列个数无关，有消息的源模块记录在模块的就绪位图中
+ *
+ *  FASTQ_BACKEND_DEFAULT   编译宏 _FASTQ_EPOLL/_FASTQ_SELECT/_FASTQ_POLL/_FASTQ_FUTEX/
+ *                          _FASTQ_IO_URING 选择的后端，都没有定义时为 select
+ *  FASTQ_BACKEND_SELECT    select() 等待门铃 eventfd；
+ *                          门铃 fd >= FD_SETSIZE(1024) 时该模块自动改用 FASTQ_BACKEND_POLL
+ *  FASTQ_BACKEND_POLL      poll() 等待门铃 eventfd，没有 fd 大小限制
+ *  FASTQ_BACKEND_EPOLL     epoll 等待门铃 eventfd，FastQGetFd 返回 epoll fd
+ *  FASTQ_BACKEND_FUTEX     不使用 eventfd，接收线程等待一个 futex，不能接入外部事件循环
+ *  FASTQ_BACKEND_IO_URING  io_uring 在门铃 eventfd 上挂多次触发的 poll（需要 5.11+ 内核）
+ */
+#define FASTQ_BACKEND_DEFAULT   0
+#define FASTQ_BACKEND_SELECT    1
+#define FASTQ_BACKEND_POLL      2
+#define FASTQ_BACKEND_EPOLL     3
+#define FASTQ_BACKEND_FUTEX     4
+#define FASTQ_BACKEND_IO_URING  5
+
+#define FASTQ_MODULE_ATTR_INITIALIZER   {0}
+
 /**
  *  FastQModuleMsgStatInfo - 统计信息
  *
@@ -90,14 +256,43 @@ typedef struct {
  *  dst_module  目的模块ID
  *  enqueue     从 src_module 发往 dst_module 的统计， src_module 已发出的消息数
  *  dequeue     从 src_module 发往 dst_module 的统计， dst_module 已接收的消息数
+ *  dropped     按 FASTQ_FULL_* 策略丢弃的消息数，被覆盖的消息已计入 enqueue
  */
 struct FastQModuleMsgStatInfo {
 	unsigned long src_module;
 	unsigned long dst_module;
 	unsigned long enqueue;
 	unsigned long dequeue;
+	unsigned long dropped;
 };
 
+/**
+ *  FASTQ_HDR_FIELD_BITS - 消息头中 msgType, msgCode, msgSubCode 的位宽 (16/32/64)
+ *
+ *  默认 64 位，与原有接口行为一致，任何值都能发送。
+ *  需要更紧凑的节点时，编译 fastq.c 和应用程序都要定义 -DFASTQ_HDR_FIELD_BITS=32 (或 16)，
+ *  此时超出位宽的值不会被截断：发送接口不发送该消息，直接返回失败。
+ */
+#ifndef FASTQ_HDR_FIELD_BITS
+# define FASTQ_HDR_FIELD_BITS   64
+#endif
+
+/**
+ *  FastQBatchMsg - 批量发送的消息描述， 见 FastQSendBatch
+ *
+ *  msgType     消息类型
+ *  msgCode     消息码
+ *  msgSubCode  次消息码
+ *  msg         传递的消息体
+ *  size        传递的消息大小
+ */
+struct FastQBatchMsg {
+	unsigned long msgType;
+	unsigned long msgCode;
+	unsigned long msgSubCode;
+	const void *msg;
+	size_t size;
+};
 
 /**
  *  fq_msg_handler_t - FastQRecvMain 接收函数
@@ -107,7 +302,7 @@ struct FastQModuleMsgStatInfo {
  *  param[in]   type    消息类型
  *  param[in]   code    消息码
  *  param[in]   subcode 次消息码
- *  param[in]   msg     接收消息地址
+ *  param[in]   msg     接收消息地址，消息已从环形队列中拷贝出来
  *  param[in]   sz      接收消息大小，与 FastQCreate (..., msg_size) 保持一致
  */
 typedef void (*fq_msg_handler_t)(unsigned long src, unsigned long dst,\
@@ -115,6 +310,53 @@ typedef void (*fq_msg_handler_t)(unsigned long src, unsigned long dst,\
 					unsigned long subcode, \
 					void*msg, size_t sz);
 
+/**
+ *  fq_msg_zc_handler_t - FastQRecvZeroCopy 接收函数
+ *
+ *  参数同 fq_msg_handler_t，但 msg 直接指向环形队列节点（只读），仅在回调期间有效
+ */
+typedef void (*fq_msg_zc_handler_t)(unsigned long src, unsigned long dst,\
+					unsigned long type, unsigned long code, \
+					unsigned long subcode, \
+					const void*msg, size_t sz);
+
+/**
+ *  FASTQ_BURST_MAX - fq_burst_handler_t 一次回调最多处理的消息数
+ */
+#ifndef FASTQ_BURST_MAX
+#define FASTQ_BURST_MAX 32
+#endif
+
+/**
+ *  FastQRecvMsg - 批量接收的消息描述， 见 fq_burst_handler_t
+ *
+ *  type        消息类型
+ *  code        消息码
+ *  subcode     次消息码
+ *  msg         接收消息地址，直接指向环形队列节点，仅在回调期间有效
+ *  size        接收消息大小
+ */
+struct FastQRecvMsg {
+	unsigned long type;
+	unsigned long code;
+	unsigned long subcode;
+	const void *msg;
+	size_t size;
+};
+
+/**
+ *  fq_burst_handler_t - FastQRecvBurst 批量接收函数
+ *
+ *  param[in]   src     源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   dst     目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   msgs    消息描述数组，参照 FastQRecvMsg 说明
+ *  param[in]   num     消息个数， 范围 1 - FASTQ_BURST_MAX
+ *
+ *  回调返回后，这批消息占用的队列节点才会被一次性归还
+ */
+typedef void (*fq_burst_handler_t)(unsigned long src, unsigned long dst,\
+					const struct FastQRecvMsg *msgs, unsigned int num);
+
 /**
  *  fq_module_filter_t - 根据目的和源模块ID进行过滤
  *
@@ -141,6 +383,22 @@ FastQCreateModule(const unsigned long moduleID,
 			const unsigned int msgMax, const unsigned int msgSize);
 
 
+/**
+ *  FastQCreateModuleAttr - 注册消息队列（指定模块属性）
+ *
+ *  param[in]   moduleID    模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   rxset       可能接收对应模块发来的消息 bitmap，见 select() fd_set
+ *  param[in]   txset       可能向对应模块发送消息 bitmap，见 select() fd_set
+ *  param[in]   msgMax      该模块 的 消息队列 的大小
+ *  param[in]   msgSize     最大传递的消息大小
+ *  param[in]   attr        模块属性，参照 FastQModuleAttr 说明， NULL 时与 FastQCreateModule 一致
+ */
+void
+FastQCreateModuleAttr(const unsigned long moduleID,
+			const mod_set *rxset, const mod_set *txset,
+			const unsigned int msgMax, const unsigned int msgSize,
+			const struct FastQModuleAttr *attr);
+
 /**
  *  FastQAttachName - 绑定 Name 到 ModuleID 消息队列, 以使用 Name发送消息
  *
@@ -176,6 +434,64 @@ bool
 FastQAddSet(const unsigned long moduleID,
 					const mod_set *rxset, const mod_set *txset);
 
+/**
+ *  FastQResizeRing - 调整队列大小（不丢失队列中的消息）
+ *
+ *  param[in]   dst     目的模块ID
+ *  param[in]   src     源模块ID
+ *  param[in]   msgMax  新的消息数（向上取 2 的幂），变长队列 按 msgSize 换算字节数
+ *
+ *  return 成功true 失败false
+ *
+ *  新队列立即用于发送，旧队列中的消息由接收者读空后释放，可以扩大也可以缩小
+ *
+ *  注意：只能在 src->dst 的发送线程中调用；
+ *       FASTQ_MODULE_F_MPSC、FASTQ_MODULE_F_MULTI_CONSUMER 队列，
+ *       或者有未提交的 FastQReserve 时返回 false
+ */
+bool
+FastQResizeRing(unsigned int dst, unsigned int src, unsigned int msgMax);
+
+/**
+ *  FastQConfigureEdge - 按源模块配置队列大小和消息大小
+ *
+ *  param[in]   src     源模块ID
+ *  param[in]   dst     目的模块ID
+ *  param[in]   msgMax  src 发往 dst 的队列大小（消息数），为 0 时使用 dst 的 msgMax
+ *  param[in]   msgSize src 发往 dst 的最大消息大小，为 0 时使用 dst 的 msgSize
+ *
+ *  return 成功true 失败false
+ *
+ *  默认所有发往 dst 的队列都按 dst 注册时的 msgMax/msgSize 分配，
+ *  流量差别很大时可以只给大流量的源模块分配大队列；变长队列 按 msgSize 换算字节数
+ *
+ *  注意：可以在 dst 注册之前调用，FastQDeleteModule 清除 dst 的所有配置；
+ *       队列已经创建时，src 下一次发送时由发送线程按新配置替换（不丢失队列中的消息，
+ *       可以在任意线程中调用），FASTQ_MODULE_F_MPSC、FASTQ_MODULE_F_MULTI_CONSUMER
+ *       队列已经创建时返回 false
+ */
+bool
+FastQConfigureEdge(unsigned int src, unsigned int dst,
+			unsigned int msgMax, unsigned int msgSize);
+
+/**
+ *  FastQSetFullPolicy - 配置 src 发往 dst 的队列满时的处理策略
+ *
+ *  param[in]   src     源模块ID
+ *  param[in]   dst     目的模块ID
+ *  param[in]   policy  FASTQ_FULL_*，默认使用 FastQModuleAttr.policy
+ *
+ *  return 成功true 失败false
+ *
+ *  注意：与 FastQConfigureEdge 相同，可以在 dst 注册之前调用；
+ *       切换到或者切换出 FASTQ_FULL_OVERWRITE 需要替换队列，src 下一次发送时由发送线程
+ *       替换，限制同 FastQConfigureEdge；
+ *       变长队列 和 多入单出队列（src 或 dst 设置了 FASTQ_MODULE_F_MPSC）不支持
+ *       FASTQ_FULL_OVERWRITE，返回 false
+ */
+bool
+FastQSetFullPolicy(unsigned int src, unsigned int dst, unsigned int policy);
+
 /**
  *  FastQDump - 显示信息
  *
@@ -200,6 +516,8 @@ FastQDumpAllModule(FILE*fp);
  *  param[in]   buf_mod_size    buf 信息结构体个数
  *  param[in]   num     函数返回时填回 的 FastQModuleMsgStatInfo 结构个数
  *  param[in]   filter  根据目的和源模块ID进行过滤 详见 fq_module_filter_t
+ *
+ *  return 成功true 失败false(不支持, 编译宏控制 _FASTQ_STATS 开启统计功能)
  */
 
 bool
@@ -217,7 +535,10 @@ FastQMsgStatInfo(struct FastQModuleMsgStatInfo *buf, unsigned int buf_mod_size,
  *  param[in]   msg     传递的消息体
  *  param[in]   size    传递的消息大小
  *
- *  return 成功true （轮询直至发送成功，只可能返回 true ）
+ *  return 成功true （轮询直至发送成功；FASTQ_FULL_DROP_* 策略下队列满时丢弃并返回 false；
+ *          FASTQ_HDR_FIELD_BITS 小于 64 且 msgType/msgCode/msgSubCode 超出位宽时返回 false）
+ *
+ *  队列满时先自旋，再 sched_yield，之后睡眠等待接收方归还节点，不会一直占用 CPU
  *
  *  注意：from 和 to 需要使用 FastQCreateModule 注册后使用
  */
@@ -226,6 +547,19 @@ FastQSend(unsigned int from, unsigned int to, unsigned long msgType,
 			unsigned long msgCode, unsigned long msgSubCode,
 			const void *msg, size_t size);
 
+/**
+ *  FastQSendTimed - 发送消息（队列满时最多等待 timeout_us 微秒）
+ *
+ *  参数与 FastQSend 一致
+ *  param[in]   timeout_us  队列满时最多等待的时间（微秒），0 与 FastQTrySend 相同
+ *
+ *  return 成功true 超时false（例如接收方已经退出）
+ */
+bool
+FastQSendTimed(unsigned int from, unsigned int to, unsigned long msgType,
+			unsigned long msgCode, unsigned long msgSubCode,
+			const void *msg, size_t size, unsigned long timeout_us);
+
 /**
  *  FastQSendByName - 发送消息（轮询直至成功发送）
  *
@@ -237,7 +571,7 @@ FastQSend(unsigned int from, unsigned int to, unsigned long msgType,
  *  param[in]   msg     传递的消息体
  *  param[in]   size    传递的消息大小
  *
- *  return 成功true （轮询直至发送成功，只可能返回 true ）
+ *  return 成功true （轮询直至发送成功；FASTQ_FULL_DROP_* 策略下队列满时丢弃并返回 false）
  *
  *  注意：from 和 to 需要使用 FastQCreateModule 注册后使用
  */
@@ -286,6 +620,234 @@ FastQTrySendByName(const char *from, const char *to, unsigned long msgType,
 				unsigned long msgCode, unsigned long msgSubCode,
 				const void *msg, size_t size);
 
+/**
+ *  消息优先级，见 FastQSendPrio
+ *
+ *  每个 (源模块,目的模块) 的高优先级消息有一个独立的小队列（FASTQ_PRIO_RING_SIZE 条），
+ *  接收方每批消息之前都会先处理所有源模块的高优先级消息
+ */
+#define FASTQ_PRIO_NORMAL   0
+#define FASTQ_PRIO_HIGH     1
+
+#ifndef FASTQ_PRIO_RING_SIZE
+#define FASTQ_PRIO_RING_SIZE    16
+#endif
+
+/**
+ *  FastQSendPrio - 按优先级发送消息（轮询直至成功发送）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   prio    FASTQ_PRIO_NORMAL 与 FastQSend 一致，FASTQ_PRIO_HIGH 高优先级
+ *  param[in]   msgType 消息类型
+ *  param[in]   msgCode 消息码
+ *  param[in]   msgSubCode 次消息码
+ *  param[in]   msg     传递的消息体
+ *  param[in]   size    传递的消息大小
+ *
+ *  return 成功true （轮询直至发送成功；FASTQ_FULL_DROP_* 策略下队列满时丢弃并返回 false）
+ *
+ *  注意：高优先级消息用于控制类消息（心跳、配置、退出等），不保证与普通消息之间的顺序，
+ *       FastQPeek/FastQRelease 只查看普通消息
+ */
+bool
+FastQSendPrio(unsigned int from, unsigned int to, unsigned int prio,
+			unsigned long msgType, unsigned long msgCode, unsigned long msgSubCode,
+			const void *msg, size_t size);
+
+/**
+ *  FastQTrySendPrio - 按优先级发送消息（队列满时直接返回false）
+ *
+ *  参数与 FastQSendPrio 一致
+ *
+ *  return 成功true 失败false
+ */
+bool
+FastQTrySendPrio(unsigned int from, unsigned int to, unsigned int prio,
+			unsigned long msgType, unsigned long msgCode, unsigned long msgSubCode,
+			const void *msg, size_t size);
+
+/**
+ *  FastQSendPrioTimed - 按优先级发送消息（队列满时最多等待 timeout_us 微秒）
+ *
+ *  参数与 FastQSendPrio 一致
+ *  param[in]   timeout_us  队列满时最多等待的时间（微秒），0 与 FastQTrySendPrio 相同
+ *
+ *  return 成功true 超时false（例如接收方已经退出）
+ */
+bool
+FastQSendPrioTimed(unsigned int from, unsigned int to, unsigned int prio,
+			unsigned long msgType, unsigned long msgCode, unsigned long msgSubCode,
+			const void *msg, size_t size, unsigned long timeout_us);
+
+/**
+ *  FastQSendBatch - 批量发送消息（轮询直至全部发送）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   msgs    消息描述数组，参照 FastQBatchMsg 说明
+ *  param[in]   num     消息个数
+ *
+ *  return 发送的消息数（轮询直至发送成功；FASTQ_FULL_DROP_* 策略下队列满时丢弃其余消息；
+ *          遇到字段超出 FASTQ_HDR_FIELD_BITS 位宽的消息时，只发送它之前的消息）
+ *
+ *  注意：一次入队的所有消息只发布一次队尾、最多通知一次接收方，
+ *       from 和 to 需要使用 FastQCreateModule 注册后使用
+ */
+unsigned int
+FastQSendBatch(unsigned int from, unsigned int to,
+			const struct FastQBatchMsg *msgs, unsigned int num);
+
+/**
+ *  FastQSendBatchByName - 批量发送消息（轮询直至全部发送）
+ *
+ *  param[in]   from    源模块名
+ *  param[in]   to      目的模块名
+ *  param[in]   msgs    消息描述数组，参照 FastQBatchMsg 说明
+ *  param[in]   num     消息个数
+ *
+ *  return 发送的消息数，模块名不存在时返回 0
+ */
+unsigned int
+FastQSendBatchByName(const char *from, const char *to,
+			const struct FastQBatchMsg *msgs, unsigned int num);
+
+/**
+ *  FastQTrySendBatch - 批量发送消息（尝试向队列中插入，能放下多少发送多少）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   msgs    消息描述数组，参照 FastQBatchMsg 说明
+ *  param[in]   num     消息个数
+ *
+ *  return 实际发送的消息数 n，即 msgs[0] - msgs[n-1] 发送成功
+ *
+ *  注意：from 和 to 需要使用 FastQCreateModule 注册后使用
+ */
+unsigned int
+FastQTrySendBatch(unsigned int from, unsigned int to,
+			const struct FastQBatchMsg *msgs, unsigned int num);
+
+/**
+ *  FastQSendBatchTimed - 批量发送消息（队列满时最多等待 timeout_us 微秒）
+ *
+ *  参数与 FastQSendBatch 一致
+ *  param[in]   timeout_us  整批消息最多等待的时间（微秒），0 与 FastQTrySendBatch 相同
+ *
+ *  return 实际发送的消息数 n，即 msgs[0] - msgs[n-1] 发送成功，超时时小于 num
+ */
+unsigned int
+FastQSendBatchTimed(unsigned int from, unsigned int to,
+			const struct FastQBatchMsg *msgs, unsigned int num, unsigned long timeout_us);
+
+/**
+ *  FastQTrySendBatchByName - 批量发送消息（尝试发送）
+ *
+ *  param[in]   from    源模块名
+ *  param[in]   to      目的模块名
+ *  param[in]   msgs    消息描述数组，参照 FastQBatchMsg 说明
+ *  param[in]   num     消息个数
+ *
+ *  return 实际发送的消息数，模块名不存在时返回 0
+ */
+unsigned int
+FastQTrySendBatchByName(const char *from, const char *to,
+			const struct FastQBatchMsg *msgs, unsigned int num);
+
+/**
+ *  FastQBroadcast - 广播消息（轮询直至成功发送）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      接收模块 bitmap，未注册的模块忽略
+ *  param[in]   msgType 消息类型
+ *  param[in]   msgCode 消息码
+ *  param[in]   msgSubCode 次消息码
+ *  param[in]   msg     传递的消息体
+ *  param[in]   size    传递的消息大小，不大于 from 模块注册时的 msgSize
+ *
+ *  return 成功true 失败false（from 未注册、to 中没有已注册的模块、size 大于 msgSize
+ *          或 字段超出 FASTQ_HDR_FIELD_BITS 位宽）
+ *
+ *  注意：每个源模块有一个广播队列（大小与 from 注册时的 msgMax/msgSize 一致），
+ *       消息体只拷贝一次，接收模块的 FastQRecv/FastQRecvBurst 直接读取，
+ *       广播队列 满时等待 被覆盖消息 的接收者中最慢的那个（自旋、让出 CPU 后睡眠，接收者读取后唤醒）；
+ *       同一个 from 只能在一个线程中广播，一个源模块最多广播给 64 个接收模块，
+ *       不支持 FASTQ_MODULE_F_MULTI_CONSUMER 的接收模块
+ */
+bool
+FastQBroadcast(unsigned int from, const mod_set *to, unsigned long msgType,
+			unsigned long msgCode, unsigned long msgSubCode,
+			const void *msg, size_t size);
+
+/**
+ *  FastQBroadcastTimed - 广播消息（广播队列满时最多等待 timeout_us 微秒）
+ *
+ *  参数与 FastQBroadcast 一致
+ *  param[in]   timeout_us  广播队列满时最多等待的时间（微秒），0 表示不等待
+ *
+ *  return 成功true 超时false（例如某个接收模块已经不再接收）
+ */
+bool
+FastQBroadcastTimed(unsigned int from, const mod_set *to, unsigned long msgType,
+			unsigned long msgCode, unsigned long msgSubCode,
+			const void *msg, size_t size, unsigned long timeout_us);
+
+/**
+ *  FastQReserve - 申请发送节点（轮询直至申请成功）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   size    将要写入的消息大小，不大于 FastQCreateModule 的 msgSize
+ *
+ *  return 队列节点中消息体的地址，调用者直接在其中构造消息；FASTQ_FULL_DROP_* 策略下队列满时返回 NULL
+ *
+ *  注意：申请到的节点必须通过 FastQCommit 发送，发送前不能再次申请，
+ *       多入单出队列 (FASTQ_MODULE_F_MPSC) 必须由申请的线程提交，
+ *       from 和 to 需要使用 FastQCreateModule 注册后使用
+ */
+void *
+FastQReserve(unsigned int from, unsigned int to, size_t size);
+
+/**
+ *  FastQTryReserve - 申请发送节点（队列满时直接返回 NULL）
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   size    将要写入的消息大小，不大于 FastQCreateModule 的 msgSize
+ *
+ *  return 队列节点中消息体的地址，队列满时返回 NULL
+ */
+void *
+FastQTryReserve(unsigned int from, unsigned int to, size_t size);
+
+/**
+ *  FastQReserveTimed - 申请发送节点（队列满时最多等待 timeout_us 微秒）
+ *
+ *  参数与 FastQReserve 一致
+ *  param[in]   timeout_us  队列满时最多等待的时间（微秒），0 与 FastQTryReserve 相同
+ *
+ *  return 队列节点中消息体的地址，超时返回 NULL
+ */
+void *
+FastQReserveTimed(unsigned int from, unsigned int to, size_t size, unsigned long timeout_us);
+
+/**
+ *  FastQCommit - 发送 FastQReserve/FastQTryReserve 申请的节点
+ *
+ *  param[in]   from    源模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   to      目的模块ID， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   msgType 消息类型
+ *  param[in]   msgCode 消息码
+ *  param[in]   msgSubCode 次消息码
+ *  param[in]   size    实际写入的消息大小，不大于申请时的 size
+ *
+ *  return 成功true；msgType/msgCode/msgSubCode 超出 FASTQ_HDR_FIELD_BITS 位宽时返回 false，
+ *         节点仍处于申请状态，需要用合法的参数再次 FastQCommit
+ */
+bool
+FastQCommit(unsigned int from, unsigned int to, unsigned long msgType,
+			unsigned long msgCode, unsigned long msgSubCode, size_t size);
+
 /**
  *  FastQRecv - 接收消息
  *
@@ -294,7 +856,8 @@ FastQTrySendByName(const char *from, const char *to, unsigned long msgType,
  *
  *  return 成功true 失败false
  *
- *  注意：from 需要使用 FastQCreateModule 注册后使用
+ *  注意：from 需要使用 FastQCreateModule 注册后使用，
+ *       只有设置了 FASTQ_MODULE_F_MULTI_CONSUMER 的模块才能由多个线程同时接收
  */
 bool
 FastQRecv(unsigned int from, fq_msg_handler_t handler);
@@ -312,6 +875,102 @@ FastQRecv(unsigned int from, fq_msg_handler_t handler);
 bool
 FastQRecvByName(const char *from, fq_msg_handler_t handler);
 
+/**
+ *  FastQRecvZeroCopy - 接收消息（零拷贝）
+ *
+ *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   handler 消息处理函数，参照 fq_msg_zc_handler_t 说明
+ *
+ *  return 成功true 失败false
+ *
+ *  注意：与 FastQRecv 相同，但不拷贝消息体，回调返回后才归还队列节点
+ */
+bool
+FastQRecvZeroCopy(unsigned int from, fq_msg_zc_handler_t handler);
+
+/**
+ *  FastQRecvBurst - 批量接收消息
+ *
+ *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   handler 批量消息处理函数，参照 fq_burst_handler_t 说明
+ *
+ *  return 成功true 失败false
+ *
+ *  注意：from 需要使用 FastQCreateModule 注册后使用
+ */
+bool
+FastQRecvBurst(unsigned int from, fq_burst_handler_t handler);
+
+/**
+ *  FastQRecvBurstByName - 批量接收消息
+ *
+ *  param[in]   from    源模块名
+ *  param[in]   handler 批量消息处理函数，参照 fq_burst_handler_t 说明
+ *
+ *  return 成功true 失败false
+ */
+bool
+FastQRecvBurstByName(const char *from, fq_burst_handler_t handler);
+
+/**
+ *  FastQRecvOnce - 处理已就绪的消息后立即返回
+ *
+ *  param[in]   from    从模块ID from 中读取消息， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   handler 消息处理函数，参照 fq_msg_handler_t 说明
+ *  param[in]   max_msgs    本次最多处理的消息数，0 表示不限制
+ *  param[in]   timeout_ms  没有就绪消息时最多等待的毫秒数，-1 一直等待，0 不等待
+ *
+ *  return 本次处理的消息数，超时返回 0，模块不存在或已被删除返回 -1
+ *
+ *  注意：超出 max_msgs 的消息留在队列中，下次调用继续处理；
+ *       适用于在自己的线程循环中穿插处理其他任务，不需要独占一个接收线程
+ */
+long
+FastQRecvOnce(unsigned int from, fq_msg_handler_t handler,
+			unsigned int max_msgs, int timeout_ms);
+
+/**
+ *  FastQGetFd - 获取模块的就绪通知 fd，用于接入外部事件循环
+ *
+ *  param[in]   module  模块ID， 范围 1 - FASTQ_ID_MAX
+ *
+ *  return 有消息可接收时可读的 fd（select/poll 后端为门铃 eventfd，epoll fd 或 io_uring fd）；
+ *         futex 后端没有 fd，返回 -1
+ *
+ *  注意：将 fd 加入外部 epoll/poll/libevent 等事件循环（EPOLLIN），
+ *       可读后调用 FastQRecvOnce(module, handler, n, 0) 处理消息，不要直接读取或关闭该 fd；
+ *       io_uring 后端 需要在等待该 fd 的线程中调用，等待时可能被完成通知打断（EINTR），重试即可
+ */
+int
+FastQGetFd(unsigned int module);
+
+/**
+ *  FastQPeek - 查看队首消息（零拷贝，不出队）
+ *
+ *  param[in]   dst     目的模块ID（接收方）， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   src     源模块ID（发送方）， 范围 0 - FASTQ_ID_MAX
+ *  param[out]  msg     队首消息描述，msg->msg 直接指向环形队列节点
+ *
+ *  return 有消息true 队列为空或不存在false
+ *
+ *  注意：msg->msg 在调用 FastQRelease 之前一直有效；
+ *       同一个 dst 不能同时使用 FastQPeek 和 FastQRecv 接收，
+ *       不支持 FASTQ_MODULE_F_MULTI_CONSUMER
+ */
+bool
+FastQPeek(unsigned int dst, unsigned int src, struct FastQRecvMsg *msg);
+
+/**
+ *  FastQRelease - 归还 FastQPeek 查看的队首消息（出队）
+ *
+ *  param[in]   dst     目的模块ID（接收方）， 范围 1 - FASTQ_ID_MAX
+ *  param[in]   src     源模块ID（发送方）， 范围 0 - FASTQ_ID_MAX
+ *
+ *  return 成功true 队列为空或不存在false
+ */
+bool
+FastQRelease(unsigned int dst, unsigned int src);
+
 /**
  *  FastQMsgNum - 获取消息数
  *
@@ -332,6 +991,9 @@ FastQMsgNum(unsigned int ID, unsigned long *nr_enqueues,
 # define FastQCreateModule(moduleID, rxset, txset, msgMax, msgSize)   \
 	FastQCreateModuleDump(moduleID, rxset, txset, msgMax, msgSize, \
 		__FILE__, __func__, __LINE__)
+# define FastQCreateModuleAttr(moduleID, rxset, txset, msgMax, msgSize, attr)   \
+	FastQCreateModuleAttrDump(moduleID, rxset, txset, msgMax, msgSize, attr, \
+		__FILE__, __func__, __LINE__)
 # define FastQDumpAllModule(fp)                 \
 	FastQDump(fp, 0)
 
@@ -345,6 +1007,13 @@ FastQCreateModuleDump(const unsigned long moduleID,
 			const unsigned int msgMax, const unsigned int msgSize,
 			const char *_file, const char *_func, const int _line);
 
+void
+FastQCreateModuleAttrDump(const unsigned long moduleID,
+			const mod_set *rxset, const mod_set *txset,
+			const unsigned int msgMax, const unsigned int msgSize,
+			const struct FastQModuleAttr *attr,
+			const char *_file, const char *_func, const int _line);
+
 #pragma GCC diagnostic pop
 
 #endif /*<__fAStMQ_H>*/
@@ -0,0 +1,1285 @@
+/******************************************************************************\
+*  文件： test-api.c
+*  介绍： 低时延队列 接口行为测试例，检查失败时打印位置并以非 0 退出
+*  作者： 荣涛
+*  日期：
+*       2026年10月17日
+*
+*  ./test-api.epoll.out
+\******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include <fastq.h>
+
+#define CHECK(cond) do {                                                    \
+		if (!(cond)) {                                                      \
+			fprintf(stderr, "FAIL %s:%d %s(): %s\n",                        \
+				__FILE__, __LINE__, __func__, #cond);                       \
+			exit(EXIT_FAILURE);                                             \
+		}                                                                   \
+	} while (0)
+
+#define NR_GOT  (1UL<<16)
+
+/* 单线程接收时记录收到的消息，见 handler_record */
+static long got[NR_GOT];
+static unsigned long nr_got;
+static unsigned long got_src;
+
+static unsigned int next_module_id = 1;
+
+static long
+now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/**
+ *  new_module - 注册一个模块，返回模块ID；收发队列都在第一次发送时创建
+ */
+static unsigned int
+new_module(unsigned long flags, unsigned int policy, unsigned int msgMax,
+		unsigned int msgSize, unsigned int backend)
+{
+	struct FastQModuleAttr attr = FASTQ_MODULE_ATTR_INITIALIZER;
+	unsigned int id = next_module_id++;
+
+	CHECK(id <= FASTQ_ID_MAX);
+
+	attr.flags = flags;
+	attr.policy = policy;
+	attr.backend = backend;
+	attr.ring_bytes = (flags & FASTQ_MODULE_F_VARLEN) ? 512 : 0;
+	attr.ring_max = (flags & FASTQ_MODULE_F_AUTO_GROW) ? 1024 : 0;
+	attr.poll_us = (flags & FASTQ_MODULE_F_BUSY_POLL) ? 20 : 0;
+
+	FastQCreateModuleAttr(id, NULL, NULL, msgMax, msgSize, &attr);
+
+	return id;
+}
+
+static void
+handler_record(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, void *msg, size_t sz)
+{
+	CHECK(sz == sizeof(long));
+	CHECK(nr_got < NR_GOT);
+
+	got_src = src;
+	got[nr_got++] = *(long *)msg;
+}
+
+static bool
+send_long(unsigned int src, unsigned int dst, long v)
+{
+	return FastQSend(src, dst, 0, 0, 0, &v, sizeof(v));
+}
+
+static bool
+try_send_long(unsigned int src, unsigned int dst, long v)
+{
+	return FastQTrySend(src, dst, 0, 0, 0, &v, sizeof(v));
+}
+
+/**
+ *  recv_all - 接收 dst 中所有已就绪的消息，追加到 got[]
+ */
+static unsigned long
+recv_all(unsigned int dst)
+{
+	unsigned long before = nr_got;
+
+	while (FastQRecvOnce(dst, handler_record, 0, 0) > 0);
+
+	return nr_got - before;
+}
+
+/**
+ *  check_seq - got[] 是 first, first+1, ... 共 n 条
+ */
+static void
+check_seq(long first, unsigned long n)
+{
+	unsigned long i;
+
+	CHECK(nr_got == n);
+	for (i = 0; i < n; i++) {
+		CHECK(got[i] == first + (long)i);
+	}
+}
+
+/**
+ *  fill - 用 FastQTrySend 填满 src->dst 的队列，返回发送的消息数（0, 1, ...）
+ */
+static unsigned long
+fill(unsigned int src, unsigned int dst)
+{
+	unsigned long n = 0;
+
+	while (try_send_long(src, dst, n)) {
+		n++;
+		CHECK(n < NR_GOT);
+	}
+	return n;
+}
+
+#if defined(_FASTQ_STATS)
+static unsigned long stat_src, stat_dst;
+
+static bool
+filter_edge(unsigned long srcID, unsigned long dstID)
+{
+	return srcID == stat_src && dstID == stat_dst;
+}
+
+/**
+ *  edge_stat - 读取 src->dst 的统计
+ */
+static void
+edge_stat(unsigned int src, unsigned int dst, struct FastQModuleMsgStatInfo *info)
+{
+	static struct FastQModuleMsgStatInfo buf[FASTQ_ID_MAX];
+	unsigned int num = 0;
+
+	stat_src = src;
+	stat_dst = dst;
+	CHECK(FastQMsgStatInfo(buf, FASTQ_ID_MAX, &num, filter_edge));
+	CHECK(num == 1);
+	*info = buf[0];
+}
+#endif
+
+/**
+ *  批量发送: 队列放不下时只发送前面的一部分，之后接着发送剩下的
+ */
+static void
+test_batch_partial(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	struct FastQBatchMsg msgs[64];
+	long v[64];
+	unsigned int i, n, rounds = 0;
+
+	for (i = 0; i < 64; i++) {
+		v[i] = i;
+		msgs[i] = (struct FastQBatchMsg){ 0, 0, 0, &v[i], sizeof(long) };
+	}
+
+	nr_got = 0;
+	n = FastQTrySendBatch(src, dst, msgs, 64);
+	CHECK(n > 0 && n < 64);
+	CHECK(FastQTrySendBatch(src, dst, &msgs[n], 64 - n) == 0);
+
+	/* 接收方腾出节点后接着发送剩下的 */
+	while (n < 64) {
+		CHECK(++rounds < 64);
+		recv_all(dst);
+		n += FastQTrySendBatch(src, dst, &msgs[n], 64 - n);
+	}
+	recv_all(dst);
+	check_seq(0, 64);
+
+	/* 阻塞的批量发送 全部发送 */
+	nr_got = 0;
+	CHECK(FastQSendBatch(src, dst, msgs, 4) == 4);
+	recv_all(dst);
+	check_seq(0, 4);
+}
+
+static unsigned long burst_total, burst_calls, burst_max;
+static long burst_next;
+
+static void
+handler_burst(unsigned long src, unsigned long dst,
+		const struct FastQRecvMsg *msgs, unsigned int num)
+{
+	unsigned int i;
+
+	CHECK(num >= 1 && num <= FASTQ_BURST_MAX);
+	for (i = 0; i < num; i++) {
+		CHECK(msgs[i].size == sizeof(long));
+		CHECK(*(const long *)msgs[i].msg == burst_next);
+		burst_next++;
+	}
+	burst_max = num > burst_max ? num : burst_max;
+	burst_calls++;
+	__atomic_add_fetch(&burst_total, num, __ATOMIC_RELEASE);
+}
+
+static void
+handler_zerocopy(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, const void *msg, size_t sz)
+{
+	CHECK(sz == sizeof(long));
+	CHECK(*(const long *)msg == burst_next);
+	burst_next++;
+	__atomic_add_fetch(&burst_total, 1, __ATOMIC_RELEASE);
+}
+
+static void
+handler_copy(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, void *msg, size_t sz)
+{
+	handler_zerocopy(src, dst, type, code, subcode, msg, sz);
+}
+
+enum { RECV_COPY, RECV_ZEROCOPY, RECV_BURST };
+
+struct recv_task_arg {
+	unsigned int dst;
+	int mode;
+};
+
+static void *
+recv_task(void *arg)
+{
+	struct recv_task_arg *parg = arg;
+
+	switch (parg->mode) {
+	case RECV_COPY:
+		FastQRecv(parg->dst, handler_copy);
+		break;
+	case RECV_ZEROCOPY:
+		FastQRecvZeroCopy(parg->dst, handler_zerocopy);
+		break;
+	case RECV_BURST:
+		FastQRecvBurst(parg->dst, handler_burst);
+		break;
+	}
+	return NULL;
+}
+
+/**
+ *  接收线程 FastQRecv/FastQRecvZeroCopy/FastQRecvBurst: 消息不丢、保序，
+ *  批量接收每次不超过 FASTQ_BURST_MAX 条；删除模块后接收函数返回
+ */
+static void
+test_recv_modes(void)
+{
+	const unsigned long N = 10000;
+	struct recv_task_arg arg;
+	pthread_t task;
+	unsigned long i;
+	long deadline;
+
+	for (arg.mode = RECV_COPY; arg.mode <= RECV_BURST; arg.mode++) {
+		unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+		unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+
+		burst_total = burst_calls = burst_max = 0;
+		burst_next = 0;
+		arg.dst = dst;
+		pthread_create(&task, NULL, recv_task, &arg);
+
+		for (i = 0; i < N; i++) {
+			CHECK(send_long(src, dst, i));
+		}
+
+		deadline = now_ms() + 10000;
+		while (__atomic_load_n(&burst_total, __ATOMIC_ACQUIRE) < N) {
+			CHECK(now_ms() < deadline);
+			usleep(1000);
+		}
+		CHECK(burst_next == (long)N);
+		if (arg.mode == RECV_BURST) {
+			CHECK(burst_calls <= N && burst_max <= FASTQ_BURST_MAX);
+		}
+
+		FastQDeleteModule(dst);
+		pthread_join(task, NULL);
+	}
+}
+
+/**
+ *  FastQReserve/FastQCommit: 直接在队列节点中构造消息；队列满时 FastQTryReserve 返回 NULL
+ */
+static void
+test_reserve_commit(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned long cap, i;
+	long *p;
+
+	nr_got = 0;
+	for (i = 0; i < 100; i++) {
+		p = FastQReserve(src, dst, sizeof(long));
+		CHECK(p);
+		*p = i;
+		CHECK(FastQCommit(src, dst, 0, 0, 0, sizeof(long)));
+		recv_all(dst);
+	}
+	check_seq(0, 100);
+
+	cap = fill(src, dst);
+	CHECK(cap > 0);
+	CHECK(FastQTryReserve(src, dst, sizeof(long)) == NULL);
+
+	nr_got = 0;
+	recv_all(dst);
+	check_seq(0, cap);
+
+	p = FastQTryReserve(src, dst, sizeof(long));
+	CHECK(p);
+	*p = 7;
+	CHECK(FastQCommit(src, dst, 0, 0, 0, sizeof(long)));
+	nr_got = 0;
+	recv_all(dst);
+	check_seq(7, 1);
+}
+
+/**
+ *  FastQPeek/FastQRelease: 查看不出队，归还之后才看到下一条
+ */
+static void
+test_peek_release(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	struct FastQRecvMsg msg;
+	long i;
+
+	CHECK(!FastQPeek(dst, src, &msg));
+
+	for (i = 0; i < 3; i++) {
+		CHECK(send_long(src, dst, 10 + i));
+	}
+	for (i = 0; i < 3; i++) {
+		CHECK(FastQPeek(dst, src, &msg));
+		CHECK(msg.size == sizeof(long) && *(const long *)msg.msg == 10 + i);
+		CHECK(FastQPeek(dst, src, &msg));
+		CHECK(*(const long *)msg.msg == 10 + i);
+		CHECK(FastQRelease(dst, src));
+	}
+	CHECK(!FastQPeek(dst, src, &msg));
+	CHECK(!FastQRelease(dst, src));
+}
+
+static unsigned long varlen_next;
+
+static void
+handler_varlen(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, void *msg, size_t sz)
+{
+	unsigned char *p = msg;
+	size_t i;
+
+	CHECK(sz == 8 + (varlen_next * 37) % 120);
+	CHECK(*(uint32_t *)p == varlen_next);
+	for (i = 4; i < sz; i++) {
+		CHECK(p[i] == (unsigned char)varlen_next);
+	}
+	varlen_next++;
+}
+
+/**
+ *  变长队列: 不同大小的消息多次绕回队列开头，大小和内容不变
+ */
+static void
+test_varlen_wrap(void)
+{
+	unsigned int dst = new_module(FASTQ_MODULE_F_VARLEN, FASTQ_FULL_BLOCK, 8, 128, 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, 128, 0);
+	unsigned char buf[128];
+	unsigned long i, full = 0;
+	size_t sz;
+
+	varlen_next = 0;
+	for (i = 0; i < 2000; i++) {
+		sz = 8 + (i * 37) % 120;
+		memset(buf, (unsigned char)i, sz);
+		*(uint32_t *)buf = i;
+
+		while (!FastQTrySend(src, dst, 0, 0, 0, buf, sz)) {
+			full++;
+			while (FastQRecvOnce(dst, handler_varlen, 0, 0) > 0);
+		}
+	}
+	while (FastQRecvOnce(dst, handler_varlen, 0, 0) > 0);
+
+	CHECK(varlen_next == 2000);
+	CHECK(full > 0);
+}
+
+static unsigned long hdr_got[3];
+
+static void
+handler_hdr(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, void *msg, size_t sz)
+{
+	hdr_got[0] = type;
+	hdr_got[1] = code;
+	hdr_got[2] = subcode;
+	nr_got++;
+}
+
+/**
+ *  消息头字段: 默认 64 位时任何值原样送达；
+ *  编译为 32/16 位时超出位宽的消息不发送，返回失败，批量发送只发送它之前的消息
+ */
+static void
+test_hdr_field_bits(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned long wide = 1UL << (sizeof(long) * 8 - 1);
+	struct FastQBatchMsg msgs[3];
+	long v = 7;
+	unsigned int i;
+
+	for (i = 0; i < 3; i++) {
+		msgs[i].msgType = 1;
+		msgs[i].msgCode = 2;
+		msgs[i].msgSubCode = 3;
+		msgs[i].msg = &v;
+		msgs[i].size = sizeof(v);
+	}
+	msgs[1].msgCode = wide;
+
+	nr_got = 0;
+#if FASTQ_HDR_FIELD_BITS == 64
+	CHECK(FastQSend(src, dst, wide, wide + 1, wide + 2, &v, sizeof(v)));
+	CHECK(FastQRecvOnce(dst, handler_hdr, 0, 0) == 1);
+	CHECK(hdr_got[0] == wide && hdr_got[1] == wide + 1 && hdr_got[2] == wide + 2);
+
+	CHECK(FastQTrySendBatch(src, dst, msgs, 3) == 3);
+	CHECK(FastQRecvOnce(dst, handler_hdr, 0, 0) == 3);
+#else
+	CHECK(!FastQSend(src, dst, wide, 0, 0, &v, sizeof(v)));
+	CHECK(!FastQTrySend(src, dst, 0, 0, wide, &v, sizeof(v)));
+	CHECK(!FastQSendPrio(src, dst, FASTQ_PRIO_HIGH, 0, wide, 0, &v, sizeof(v)));
+	CHECK(FastQRecvOnce(dst, handler_hdr, 0, 0) == 0);
+
+	/* 位宽内的最大值仍能送达 */
+	CHECK(FastQSend(src, dst, (1UL << FASTQ_HDR_FIELD_BITS) - 1, 0, 0, &v, sizeof(v)));
+	CHECK(FastQRecvOnce(dst, handler_hdr, 0, 0) == 1);
+	CHECK(hdr_got[0] == (1UL << FASTQ_HDR_FIELD_BITS) - 1);
+
+	CHECK(FastQTrySendBatch(src, dst, msgs, 3) == 1);
+	CHECK(FastQRecvOnce(dst, handler_hdr, 0, 0) == 1);
+	CHECK(hdr_got[1] == 2);
+#endif
+}
+
+#define MP_THREADS  4
+#define MP_NUM      20000
+
+static long mp_last[MP_THREADS];
+static unsigned long mp_total;
+
+static void
+handler_mp(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, void *msg, size_t sz)
+{
+	long v = *(long *)msg;
+	long tid = v >> 32, seq = v & 0xffffffff;
+
+	CHECK(tid >= 0 && tid < MP_THREADS);
+	CHECK(seq == mp_last[tid] + 1);
+	mp_last[tid] = seq;
+	mp_total++;
+}
+
+struct mp_arg {
+	unsigned int src, dst;
+	long tid;
+};
+
+static void *
+mp_send_task(void *arg)
+{
+	struct mp_arg *parg = arg;
+	long i;
+
+	for (i = 0; i < MP_NUM; i++) {
+		CHECK(send_long(parg->src, parg->dst, parg->tid << 32 | i));
+	}
+	return NULL;
+}
+
+/**
+ *  多入单出队列: 多个线程以同一个源模块发送，消息不丢，每个线程的消息保序
+ */
+static void
+test_mpsc(void)
+{
+	unsigned int dst = new_module(FASTQ_MODULE_F_MPSC, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	unsigned int src = new_module(FASTQ_MODULE_F_MPSC, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	struct mp_arg args[MP_THREADS];
+	pthread_t tasks[MP_THREADS];
+	long i, deadline = now_ms() + 30000;
+
+	mp_total = 0;
+	for (i = 0; i < MP_THREADS; i++) {
+		mp_last[i] = -1;
+		args[i] = (struct mp_arg){ src, dst, i };
+		pthread_create(&tasks[i], NULL, mp_send_task, &args[i]);
+	}
+	while (mp_total < MP_THREADS * MP_NUM) {
+		CHECK(now_ms() < deadline);
+		CHECK(FastQRecvOnce(dst, handler_mp, 0, 100) >= 0);
+	}
+	for (i = 0; i < MP_THREADS; i++) {
+		pthread_join(tasks[i], NULL);
+		CHECK(mp_last[i] == MP_NUM - 1);
+	}
+}
+
+static unsigned long mpv_next[MP_THREADS];
+
+static void
+handler_mp_varlen(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, void *msg, size_t sz)
+{
+	unsigned char *p = msg;
+
+	CHECK(type < MP_THREADS);
+	CHECK(code == mpv_next[type]);
+	CHECK(sz == 8 + code % 120 && p[sz - 1] == (unsigned char)code);
+	mpv_next[type]++;
+	mp_total++;
+}
+
+static void *
+mp_varlen_send_task(void *arg)
+{
+	struct mp_arg *parg = arg;
+	unsigned char buf[128];
+	unsigned long i;
+	size_t sz;
+
+	for (i = 0; i < MP_NUM; i++) {
+		sz = 8 + i % 120;
+		memset(buf, (unsigned char)i, sz);
+		CHECK(FastQSend(parg->src, parg->dst, parg->tid, i, 0, buf, sz));
+	}
+	return NULL;
+}
+
+/**
+ *  多入单出源模块发往变长队列模块: 队列退化为定长，多个线程发送不同大小的消息
+ */
+static void
+test_mpsc_varlen(void)
+{
+	unsigned int dst = new_module(FASTQ_MODULE_F_VARLEN, FASTQ_FULL_BLOCK, 8, 128, 0);
+	unsigned int src = new_module(FASTQ_MODULE_F_MPSC, FASTQ_FULL_BLOCK, 8, 128, 0);
+	struct mp_arg args[MP_THREADS];
+	pthread_t tasks[MP_THREADS];
+	long i, deadline = now_ms() + 30000;
+
+	mp_total = 0;
+	for (i = 0; i < MP_THREADS; i++) {
+		mpv_next[i] = 0;
+		args[i] = (struct mp_arg){ src, dst, i };
+		pthread_create(&tasks[i], NULL, mp_varlen_send_task, &args[i]);
+	}
+	while (mp_total < MP_THREADS * MP_NUM) {
+		CHECK(now_ms() < deadline);
+		CHECK(FastQRecvOnce(dst, handler_mp_varlen, 0, 100) >= 0);
+	}
+	for (i = 0; i < MP_THREADS; i++) {
+		pthread_join(tasks[i], NULL);
+		CHECK(mpv_next[i] == MP_NUM);
+	}
+}
+
+#define MC_SRCS     4
+#define MC_THREADS  3
+#define MC_NUM      20000
+
+static unsigned int mc_src_base;
+static unsigned char mc_seen[MC_SRCS][MC_NUM];
+static long mc_last[MC_SRCS];
+static unsigned long mc_total;
+
+static void
+handler_mc(unsigned long src, unsigned long dst, unsigned long type,
+		unsigned long code, unsigned long subcode, void *msg, size_t sz)
+{
+	unsigned long s = src - mc_src_base;
+	long v = *(long *)msg;
+
+	CHECK(s < MC_SRCS && v >= 0 && v < MC_NUM);
+	CHECK(__atomic_exchange_n(&mc_seen[s][v], 1, __ATOMIC_RELAXED) == 0);
+
+	/* 同一个源模块的队列同时只被一个线程处理 */
+	CHECK(v == mc_last[s] + 1);
+	mc_last[s] = v;
+
+	__atomic_add_fetch(&mc_total, 1, __ATOMIC_RELAXED);
+}
+
+static void *
+mc_recv_task(void *arg)
+{
+	unsigned int dst = (unsigned long)arg;
+
+	while (__atomic_load_n(&mc_total, __ATOMIC_RELAXED) < MC_SRCS * MC_NUM) {
+		CHECK(FastQRecvOnce(dst, handler_mc, 64, 10) >= 0);
+	}
+	return NULL;
+}
+
+static void *
+mc_send_task(void *arg)
+{
+	struct mp_arg *parg = arg;
+	long i;
+
+	for (i = 0; i < MC_NUM; i++) {
+		CHECK(send_long(parg->src, parg->dst, i));
+	}
+	return NULL;
+}
+
+/**
+ *  多消费者模式: 多个线程同时接收，消息不丢、不重复，同一个源模块的消息保序
+ */
+static void
+test_multi_consumer(void)
+{
+	unsigned int dst = new_module(FASTQ_MODULE_F_MULTI_CONSUMER, FASTQ_FULL_BLOCK,
+				64, sizeof(long), 0);
+	pthread_t rx[MC_THREADS], tx[MC_SRCS];
+	struct mp_arg args[MC_SRCS];
+	long i;
+
+	mc_src_base = next_module_id;
+	mc_total = 0;
+	for (i = 0; i < MC_SRCS; i++) {
+		mc_last[i] = -1;
+		args[i] = (struct mp_arg){ new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0), dst, i };
+	}
+	for (i = 0; i < MC_THREADS; i++) {
+		pthread_create(&rx[i], NULL, mc_recv_task, (void *)(unsigned long)dst);
+	}
+	for (i = 0; i < MC_SRCS; i++) {
+		pthread_create(&tx[i], NULL, mc_send_task, &args[i]);
+	}
+	for (i = 0; i < MC_SRCS; i++) {
+		pthread_join(tx[i], NULL);
+	}
+	for (i = 0; i < MC_THREADS; i++) {
+		pthread_join(rx[i], NULL);
+	}
+	for (i = 0; i < MC_SRCS; i++) {
+		CHECK(mc_last[i] == MC_NUM - 1);
+	}
+}
+
+static void *
+bcast_drain_task(void *arg)
+{
+	unsigned int *mods = arg;
+
+	usleep(50000);
+	recv_all(mods[0]);
+	recv_all(mods[1]);
+	return NULL;
+}
+
+/**
+ *  广播: 接收模块删除后不再收到，重新注册的接收模块只收到之后的广播
+ */
+static void
+test_bcast_join_leave(void)
+{
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int a = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int b = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int nobody = next_module_id++;
+	unsigned int drain[2];
+	mod_set to, none;
+	pthread_t task;
+	long v, t0;
+
+	MOD_ZERO(&to);
+	MOD_SET(a, &to);
+	MOD_SET(b, &to);
+	MOD_ZERO(&none);
+	MOD_SET(nobody, &none);
+
+	CHECK(!FastQBroadcast(src, &none, 0, 0, 0, &v, sizeof(v)));
+	/* 超过 msgSize 的消息不发送 */
+	CHECK(!FastQBroadcast(src, &to, 0, 0, 0, got, sizeof(long) + 1));
+
+	v = 1;
+	CHECK(FastQBroadcast(src, &to, 0, 0, 0, &v, sizeof(v)));
+	nr_got = 0;
+	recv_all(a);
+	check_seq(1, 1);
+	CHECK(got_src == src);
+	nr_got = 0;
+	recv_all(b);
+	check_seq(1, 1);
+
+	/* b 离开 */
+	FastQDeleteModule(b);
+	v = 2;
+	CHECK(FastQBroadcast(src, &to, 0, 0, 0, &v, sizeof(v)));
+	nr_got = 0;
+	recv_all(a);
+	check_seq(2, 1);
+
+	/* b 重新加入 */
+	FastQCreateModule(b, NULL, NULL, 8, sizeof(long));
+	v = 3;
+	CHECK(FastQBroadcast(src, &to, 0, 0, 0, &v, sizeof(v)));
+	nr_got = 0;
+	recv_all(b);
+	check_seq(3, 1);
+	nr_got = 0;
+	recv_all(a);
+	check_seq(3, 1);
+
+	/* 广播队列满时等待最慢的接收者 */
+	for (v = 0; v < 100; v++) {
+		CHECK(FastQBroadcast(src, &to, 0, 0, 0, &v, sizeof(v)));
+		if (v % 4 == 3) {
+			recv_all(a);
+			recv_all(b);
+		}
+	}
+	recv_all(a);
+	recv_all(b);
+
+	/* b 不接收: 超时返回 false；b 接收之后阻塞的广播返回 */
+	for (v = 0; FastQBroadcastTimed(src, &to, 0, 0, 0, &v, sizeof(v), 0); v++) {
+		recv_all(a);
+		CHECK(v < 1000);
+	}
+	CHECK(v > 0);
+
+	t0 = now_ms();
+	CHECK(!FastQBroadcastTimed(src, &to, 0, 0, 0, &v, sizeof(v), 20000));
+	CHECK(now_ms() - t0 >= 15);
+
+	drain[0] = a;
+	drain[1] = b;
+	pthread_create(&task, NULL, bcast_drain_task, drain);
+	CHECK(FastQBroadcast(src, &to, 0, 0, 0, &v, sizeof(v)));
+	pthread_join(task, NULL);
+}
+
+/**
+ *  高优先级消息: 先于已经在队列中的普通消息处理
+ */
+static void
+test_prio_order(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	long v, i;
+
+	for (i = 1; i <= 10; i++) {
+		CHECK(send_long(src, dst, i));
+	}
+	v = 100;
+	CHECK(FastQSendPrio(src, dst, FASTQ_PRIO_HIGH, 0, 0, 0, &v, sizeof(v)));
+	v = 101;
+	CHECK(FastQTrySendPrio(src, dst, FASTQ_PRIO_HIGH, 0, 0, 0, &v, sizeof(v)));
+
+	nr_got = 0;
+	recv_all(dst);
+	CHECK(nr_got == 12);
+	CHECK(got[0] == 100 && got[1] == 101);
+	for (i = 1; i <= 10; i++) {
+		CHECK(got[i + 1] == i);
+	}
+}
+
+static volatile int reconf_stop;
+
+static void *
+reconf_task(void *arg)
+{
+	unsigned int *edge = arg;
+	unsigned int k = 0;
+
+	while (!reconf_stop) {
+		CHECK(FastQConfigureEdge(edge[0], edge[1], 16 << (k++ % 5), 0));
+		usleep(200);
+	}
+	return NULL;
+}
+
+static void *
+seq_send_task(void *arg)
+{
+	unsigned int *edge = arg;
+	long i;
+
+	for (i = 0; i < edge[2]; i++) {
+		CHECK(send_long(edge[0], edge[1], i));
+	}
+	return NULL;
+}
+
+/**
+ *  调整队列大小: FastQConfigureEdge 在发送方下一次发送时生效，FastQResizeRing，
+ *  自动扩容，以及发送过程中其他线程反复 FastQConfigureEdge，消息都不丢、保序
+ */
+static void
+test_resize(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	unsigned int edge[3];
+	pthread_t tasks[2];
+	long i, deadline;
+
+	nr_got = 0;
+	for (i = 0; i < 5; i++) {
+		CHECK(try_send_long(src, dst, i));
+	}
+	CHECK(FastQConfigureEdge(src, dst, 256, 0));
+	for (; i < 205; i++) {
+		CHECK(try_send_long(src, dst, i));
+	}
+	CHECK(FastQResizeRing(dst, src, 1024));
+	for (; i < 1000; i++) {
+		CHECK(try_send_long(src, dst, i));
+	}
+	recv_all(dst);
+	check_seq(0, 1000);
+
+	/* 自动扩容: 队列满时发送方扩容而不是等待 */
+	dst = new_module(FASTQ_MODULE_F_AUTO_GROW, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	for (i = 0; i < 1000; i++) {
+		CHECK(send_long(src, dst, i));
+	}
+	nr_got = 0;
+	recv_all(dst);
+	check_seq(0, 1000);
+
+	/* 其他线程修改配置 */
+	dst = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	edge[0] = src;
+	edge[1] = dst;
+	edge[2] = 50000;
+	reconf_stop = 0;
+	pthread_create(&tasks[0], NULL, seq_send_task, edge);
+	pthread_create(&tasks[1], NULL, reconf_task, edge);
+
+	nr_got = 0;
+	deadline = now_ms() + 30000;
+	while (nr_got < edge[2]) {
+		CHECK(now_ms() < deadline);
+		CHECK(FastQRecvOnce(dst, handler_record, 0, 100) >= 0);
+	}
+	reconf_stop = 1;
+	pthread_join(tasks[0], NULL);
+	pthread_join(tasks[1], NULL);
+	check_seq(0, edge[2]);
+}
+
+/**
+ *  队列满时的处理策略 和 丢弃计数
+ */
+static void
+test_full_policy(void)
+{
+	struct FastQBatchMsg batch[2] = {
+		{ 0, 0, 0, &batch, sizeof(long) },
+		{ 0, 0, 0, &batch, sizeof(long) },
+	};
+	unsigned int dst, src;
+	unsigned long cap, ok, i;
+	long v, t0;
+#if defined(_FASTQ_STATS)
+	struct FastQModuleMsgStatInfo info;
+#endif
+
+	/* FASTQ_FULL_BLOCK: FastQTrySend 失败，FastQSendTimed 超时 */
+	dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	cap = fill(src, dst);
+	CHECK(cap > 0);
+	v = cap;
+	t0 = now_ms();
+	CHECK(!FastQSendTimed(src, dst, 0, 0, 0, &v, sizeof(v), 20000));
+	CHECK(now_ms() - t0 >= 15);
+	CHECK(FastQRecvOnce(dst, handler_record, 1, 0) == 1);
+	CHECK(FastQSendTimed(src, dst, 0, 0, 0, &v, sizeof(v), 20000));
+
+	/* 队列满时切换为 FASTQ_FULL_DROP_NEWEST 立即生效 */
+	CHECK(FastQSetFullPolicy(src, dst, FASTQ_FULL_DROP_NEWEST));
+	CHECK(!send_long(src, dst, -1));
+#if defined(_FASTQ_STATS)
+	edge_stat(src, dst, &info);
+	CHECK(info.dropped == 1 && info.enqueue == cap + 1);
+#endif
+
+	/* 其他阻塞接口的超时版本 */
+	dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	cap = fill(src, dst);
+	t0 = now_ms();
+	CHECK(FastQSendBatchTimed(src, dst, batch, 2, 20000) == 0);
+	CHECK(now_ms() - t0 >= 15);
+	t0 = now_ms();
+	CHECK(FastQReserveTimed(src, dst, sizeof(long), 20000) == NULL);
+	CHECK(now_ms() - t0 >= 15);
+	for (ok = 0; FastQTrySendPrio(src, dst, FASTQ_PRIO_HIGH, 0, 0, 0, &v, sizeof(v)); ok++);
+	t0 = now_ms();
+	CHECK(!FastQSendPrioTimed(src, dst, FASTQ_PRIO_HIGH, 0, 0, 0, &v, sizeof(v), 20000));
+	CHECK(now_ms() - t0 >= 15);
+	nr_got = 0;
+	recv_all(dst);
+	CHECK(ok > 0 && nr_got == cap + ok);
+	CHECK(FastQSendBatchTimed(src, dst, batch, 2, 20000) == 2);
+	CHECK(FastQSendPrioTimed(src, dst, FASTQ_PRIO_HIGH, 0, 0, 0, &v, sizeof(v), 20000));
+	recv_all(dst);
+
+	/* FASTQ_FULL_DROP_NEWEST: 发送之前按源模块配置 */
+	dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	CHECK(FastQSetFullPolicy(src, dst, FASTQ_FULL_DROP_NEWEST));
+	for (i = ok = 0; i < 100; i++) {
+		ok += send_long(src, dst, i);
+	}
+	CHECK(ok > 0 && ok < 100);
+	nr_got = 0;
+	recv_all(dst);
+	check_seq(0, ok);
+#if defined(_FASTQ_STATS)
+	edge_stat(src, dst, &info);
+	CHECK(info.dropped == 100 - ok);
+	CHECK(info.enqueue == ok && info.dequeue == ok);
+#endif
+
+	/* 多入单出队列 不能覆盖，配置失败，原策略不变 */
+	dst = new_module(0, FASTQ_FULL_DROP_NEWEST, 8, sizeof(long), 0);
+	src = new_module(FASTQ_MODULE_F_MPSC, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	CHECK(!FastQSetFullPolicy(src, dst, FASTQ_FULL_OVERWRITE));
+	CHECK(!FastQSetFullPolicy(dst, src, FASTQ_FULL_OVERWRITE));
+	cap = fill(src, dst);
+	CHECK(cap > 0 && !send_long(src, dst, -1));
+
+	/* FASTQ_FULL_OVERWRITE: 发送总是成功，接收方看到最新的消息 */
+	dst = new_module(0, FASTQ_FULL_OVERWRITE, 8, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	for (i = 0; i < 1000; i++) {
+		CHECK(send_long(src, dst, i));
+	}
+	nr_got = 0;
+	recv_all(dst);
+	CHECK(nr_got > 0 && nr_got < 1000);
+	check_seq(1000 - nr_got, nr_got);
+#if defined(_FASTQ_STATS)
+	/* 被覆盖的消息计入入队数和丢弃数 */
+	edge_stat(src, dst, &info);
+	CHECK(info.enqueue == 1000);
+	CHECK(info.dropped == 1000 - nr_got);
+	CHECK(info.dequeue == nr_got);
+#endif
+
+	/* 发送之后切换到 FASTQ_FULL_OVERWRITE，发送方下一次发送时替换队列 */
+	dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	cap = fill(src, dst);
+	CHECK(FastQSetFullPolicy(src, dst, FASTQ_FULL_OVERWRITE));
+	for (i = cap; i < 1000; i++) {
+		CHECK(send_long(src, dst, i));
+	}
+	nr_got = 0;
+	recv_all(dst);
+	CHECK(nr_got > cap);
+	for (i = 0; i < cap; i++) {
+		CHECK(got[i] == (long)i);
+	}
+	CHECK(got[nr_got - 1] == 999);
+
+	/* FASTQ_FULL_DROP_PRIO: 丢弃普通消息，高优先级消息仍然发送 */
+	dst = new_module(0, FASTQ_FULL_DROP_PRIO, 8, sizeof(long), 0);
+	src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+	cap = fill(src, dst);
+	CHECK(!send_long(src, dst, -1));
+	v = 1000;
+	CHECK(FastQSendPrio(src, dst, FASTQ_PRIO_HIGH, 0, 0, 0, &v, sizeof(v)));
+	nr_got = 0;
+	recv_all(dst);
+	CHECK(nr_got == cap + 1 && got[0] == 1000);
+#if defined(_FASTQ_STATS)
+	/* fill 最后一次失败的 FastQTrySend 也按策略丢弃 */
+	edge_stat(src, dst, &info);
+	CHECK(info.dropped == 2);
+#endif
+}
+
+/**
+ *  FastQRecvOnce/FastQGetFd: 外部事件循环等待 fd，按 max_msgs 分次处理，超时返回 0，
+ *  模块删除后返回 -1
+ */
+static void
+test_recv_once_fd(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	struct pollfd pfd;
+	long i, t0;
+	int fd;
+
+	fd = FastQGetFd(dst);
+#if defined(_FASTQ_FUTEX)
+	CHECK(fd == -1);
+#else
+	CHECK(fd >= 0);
+#endif
+
+	CHECK(send_long(src, dst, 0));
+	if (fd >= 0) {
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		CHECK(poll(&pfd, 1, 1000) == 1 && (pfd.revents & POLLIN));
+	}
+	nr_got = 0;
+	CHECK(FastQRecvOnce(dst, handler_record, 0, 0) == 1);
+
+	for (i = 1; i <= 5; i++) {
+		CHECK(send_long(src, dst, i));
+	}
+	CHECK(FastQRecvOnce(dst, handler_record, 2, 0) == 2);
+	CHECK(FastQRecvOnce(dst, handler_record, 0, 0) == 3);
+	check_seq(0, 6);
+
+	t0 = now_ms();
+	CHECK(FastQRecvOnce(dst, handler_record, 0, 20) == 0);
+	CHECK(now_ms() - t0 >= 15);
+
+	FastQDeleteModule(dst);
+	CHECK(FastQRecvOnce(dst, handler_record, 0, 0) == -1);
+}
+
+/**
+ *  忙轮询模式 和 只轮询模式: 消息不丢、保序，空闲之后发送方仍能唤醒接收方
+ */
+static void
+test_busy_poll(void)
+{
+	static const unsigned long modes[] = {
+		FASTQ_MODULE_F_BUSY_POLL,
+		FASTQ_MODULE_F_POLL_ONLY,
+	};
+	unsigned int edge[3];
+	pthread_t task;
+	unsigned int m;
+	long t0;
+
+	for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		unsigned int dst = new_module(modes[m], FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+		unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+
+		edge[0] = src;
+		edge[1] = dst;
+		edge[2] = 50000;
+		nr_got = 0;
+		pthread_create(&task, NULL, seq_send_task, edge);
+		while (nr_got < edge[2]) {
+			CHECK(FastQRecvOnce(dst, handler_record, 0, 5000) > 0);
+		}
+		pthread_join(task, NULL);
+		check_seq(0, edge[2]);
+
+		/* 接收方空闲超过 poll_us 之后 */
+		t0 = now_ms();
+		CHECK(FastQRecvOnce(dst, handler_record, 0, 20) == 0);
+		CHECK(now_ms() - t0 >= 15);
+
+		edge[2] = 1;
+		nr_got = 0;
+		pthread_create(&task, NULL, seq_send_task, edge);
+		CHECK(FastQRecvOnce(dst, handler_record, 0, 5000) == 1);
+		pthread_join(task, NULL);
+		check_seq(0, 1);
+	}
+}
+
+/**
+ *  doorbell_count - 读空 poll 后端的门铃 eventfd，返回生产者敲门铃的次数
+ */
+static unsigned long
+doorbell_count(int fd)
+{
+	uint64_t cnt;
+
+	if (read(fd, &cnt, sizeof(cnt)) != sizeof(cnt)) {
+		return 0;
+	}
+	return cnt;
+}
+
+/**
+ *  门铃合并: 一批消息只敲一次门铃，多个源模块的队列共用一次；
+ *  FastQRecvOnce 限制条数后队列还有消息时再敲一次，处理完后不再敲
+ */
+static void
+test_doorbell(void)
+{
+	unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), FASTQ_BACKEND_POLL);
+	unsigned int src[3];
+	struct pollfd pfd;
+	long i, j;
+
+	for (j = 0; j < 3; j++) {
+		src[j] = new_module(0, FASTQ_FULL_BLOCK, 64, sizeof(long), 0);
+	}
+
+	pfd.fd = FastQGetFd(dst);
+	pfd.events = POLLIN;
+	CHECK(pfd.fd >= 0);
+	CHECK(doorbell_count(pfd.fd) == 0);
+
+	for (i = 0; i < 10; i++) {
+		CHECK(send_long(src[0], dst, i));
+	}
+	CHECK(doorbell_count(pfd.fd) == 1);
+
+	/* 只处理 3 条，队列仍然就绪，返回前再敲一次门铃 */
+	nr_got = 0;
+	CHECK(FastQRecvOnce(dst, handler_record, 3, 0) == 3);
+	CHECK(poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN));
+	CHECK(doorbell_count(pfd.fd) == 1);
+
+	CHECK(recv_all(dst) == 7);
+	check_seq(0, 10);
+	CHECK(poll(&pfd, 1, 0) == 0);
+
+	/* 三个源模块各发一批，就绪位图记录三个队列，只敲一次门铃 */
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < 5; i++) {
+			CHECK(send_long(src[j], dst, j * 5 + i));
+		}
+	}
+	CHECK(doorbell_count(pfd.fd) == 1);
+
+	nr_got = 0;
+	CHECK(recv_all(dst) == 15);
+	for (j = 0; j < 15; j++) {
+		CHECK(got[j] >= 0 && got[j] < 15);
+		for (i = 0; i < j; i++) {
+			CHECK(got[i] != got[j]);
+			/* 同一个源模块的消息保序 */
+			CHECK(got[i] / 5 != got[j] / 5 || got[i] < got[j]);
+		}
+	}
+	CHECK(poll(&pfd, 1, 0) == 0);
+	CHECK(doorbell_count(pfd.fd) == 0);
+}
+
+static void *
+delayed_send_task(void *arg)
+{
+	unsigned int *edge = arg;
+
+	usleep(10000);
+	CHECK(send_long(edge[0], edge[1], 42));
+	return NULL;
+}
+
+/**
+ *  每种通知后端: 门铃 fd 大于 1023 时仍能睡眠等待并被唤醒（select 后端改用 poll）
+ */
+static void
+test_high_fd_backends(void)
+{
+	struct rlimit rl;
+	int fds[1200], nfds = 0, fd;
+	unsigned int backend, edge[2];
+	pthread_t task;
+
+	CHECK(getrlimit(RLIMIT_NOFILE, &rl) == 0);
+	if (rl.rlim_max != RLIM_INFINITY && rl.rlim_max < 2048) {
+		printf("  skip %s: RLIMIT_NOFILE hard limit %lu\n", __func__,
+			(unsigned long)rl.rlim_max);
+		return;
+	}
+	if (rl.rlim_cur < 2048) {
+		rl.rlim_cur = 2048;
+		CHECK(setrlimit(RLIMIT_NOFILE, &rl) == 0);
+	}
+
+	while (nfds < 1200 && (fd = open("/dev/null", O_RDONLY)) >= 0) {
+		fds[nfds++] = fd;
+		if (fd > 1100) {
+			break;
+		}
+	}
+	CHECK(fd > 1023);
+
+	for (backend = FASTQ_BACKEND_SELECT; backend <= FASTQ_BACKEND_IO_URING; backend++) {
+		unsigned int dst = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), backend);
+		unsigned int src = new_module(0, FASTQ_FULL_BLOCK, 8, sizeof(long), 0);
+
+		edge[0] = src;
+		edge[1] = dst;
+		nr_got = 0;
+		pthread_create(&task, NULL, delayed_send_task, edge);
+		CHECK(FastQRecvOnce(dst, handler_record, 0, 5000) == 1);
+		pthread_join(task, NULL);
+		check_seq(42, 1);
+
+		FastQDeleteModule(dst);
+	}
+
+	while (nfds) {
+		close(fds[--nfds]);
+	}
+}
+
+static const struct {
+	const char *name;
+	void (*func)(void);
+} tests[] = {
+#define __(f) { #f, f }
+	__(test_batch_partial),
+	__(test_recv_modes),
+	__(test_reserve_commit),
+	__(test_peek_release),
+	__(test_varlen_wrap),
+	__(test_hdr_field_bits),
+	__(test_mpsc),
+	__(test_mpsc_varlen),
+	__(test_multi_consumer),
+	__(test_bcast_join_leave),
+	__(test_prio_order),
+	__(test_resize),
+	__(test_full_policy),
+	__(test_recv_once_fd),
+	__(test_busy_poll),
+	__(test_doorbell),
+	__(test_high_fd_backends),
+#undef __
+};
+
+int main()
+{
+	unsigned int i;
+
+	/* 卡住时由 SIGALRM 结束进程 */
+	alarm(300);
+
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		tests[i].func();
+		printf("  ok  %s\n", tests[i].name);
+	}
+	printf("All %u tests passed.\n", i);
+
+	return EXIT_SUCCESS;
+}